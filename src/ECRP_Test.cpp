@@ -2,18 +2,30 @@
 #include <iostream>
 
 #include <assert.h>
+#include <random>
+#include <algorithm>
+#include <memory>
 
 using std::exception;
 using std::cout;
 using std::cerr;
 using std::endl;
 
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+
 #include "utils/utils.h"
 #include "utils/varints.h"
 #include "crypto/Crypto.h"
+#include "crypto/MultiSha256.h"
+#include "blockchain/Blockchain.h"
+#include "blockchain/Miner.h"
 #include "errors/Error.h"
 
 using namespace ecrp::crypto;
+using ecrp::blockchain::Blockchain;
+using ecrp::blockchain::MasterBlock;
+using ecrp::blockchain::Miner;
 
 const bool VERBOSE = false;
 const int LOOP_COUNT = 20000;
@@ -36,6 +48,16 @@ __assert(const char *file, int line, const char *failedexpr)
 	__assert_func(file, line, NULL, failedexpr);
 }
 
+// assert() is stubbed out above, so the checks report their failures themselves and main() returns their count.
+int failureCount = 0;
+
+void check(bool isPassed, const std::string& what) {
+	if (!isPassed) {
+		cerr << "Check failed: " << what << endl;
+		failureCount++;
+	}
+}
+
 /*void ff() {
 	try {
 		PrivateKey* privateKey = generateKey();
@@ -147,6 +169,55 @@ template<class bXXX> void testSign(const char* algoName) {
 	delete privateKey;
 }
 
+// Whether signData() accepts a key of type K by reference, the deleted overloads making the call ill-formed.
+template<class K, class S> auto canSignData(int) -> decltype(signData((const void*)NULL, (size_t)0, std::declval<const K&>(), std::declval<S&>()), true) {
+	return true;
+}
+
+template<class K, class S> bool canSignData(...) {
+	return false;
+}
+
+template<class bXXX> void testSignInPlace(const char* algoName) {
+	PrivateKey<bXXX> privateKey;
+	Signature<bXXX> signature;
+	generateKey(privateKey);
+
+	uint64_t t0 = ecrp::getTimestampUTC();
+	cout << "Signing " << LOOP_COUNT << " messages in place with the " << algoName << " algorithm..." << endl;
+	for (int i = 0; i < LOOP_COUNT; i++) {
+		try {
+			signData(COMMON_MSG.c_str(), COMMON_MSG.size(), privateKey, signature);
+		} catch (const ecrp::Error& e) {
+			cerr << e.what() << endl;
+		}
+	}
+	uint64_t dt = ecrp::getTimestampUTC() - t0;
+	double n = (double)(1000 * LOOP_COUNT) / dt;
+	cout << "Done in " << dt << " ms. (" << std::setprecision(6) << n << " signatures/s)" << endl;
+
+	check(verifyData(COMMON_MSG.c_str(), COMMON_MSG.size(), signature, privateKey), std::string(algoName) + " signature made in place verifies");
+
+	DerivativeKey<bXXX> derivativeKey;
+	deriveKey(privateKey, 12, derivativeKey);
+	signDataWithDerivativeKey(COMMON_MSG.c_str(), COMMON_MSG.size(), derivativeKey, signature);
+	check(verifyData(COMMON_MSG.c_str(), COMMON_MSG.size(), signature, derivativeKey), std::string(algoName) + " signature made in place with a derivative key verifies");
+
+	// the pointer API tells a derivative key apart even behind a PrivateKey pointer
+	const PrivateKey<bXXX>* pKey = &derivativeKey;
+	Signature<bXXX>* pSignature = signData(COMMON_MSG.c_str(), COMMON_MSG.size(), pKey);
+	check(verifyData(COMMON_MSG.c_str(), COMMON_MSG.size(), *pSignature, derivativeKey), std::string(algoName) + " signature made from a derivative key behind a PrivateKey pointer verifies");
+	delete pSignature;
+
+	pKey = &privateKey;
+	pSignature = signData(COMMON_MSG.c_str(), COMMON_MSG.size(), pKey);
+	check(verifyData(COMMON_MSG.c_str(), COMMON_MSG.size(), *pSignature, privateKey), std::string(algoName) + " signature made from a PrivateKey pointer verifies");
+	delete pSignature;
+
+	check(canSignData<PrivateKey<bXXX>, Signature<bXXX> >(0), std::string(algoName) + " signData accepts a private key");
+	check(!canSignData<DerivativeKey<bXXX>, Signature<bXXX> >(0), std::string(algoName) + " signData refuses a derivative key");
+}
+
 template<class bXXX> void testVerify(const char* algoName) {
 	// Generating a unique key and signature.
 	PrivateKey<bXXX>* privateKey = NULL;
@@ -196,6 +267,10 @@ void testStrongSign() {
 	testSign<b456>("Ed448");
 }
 
+void testStrongSignInPlace() {
+	testSignInPlace<b456>("Ed448");
+}
+
 void testStrongVerify() {
 	testVerify<b456>("Ed448");
 }
@@ -208,6 +283,10 @@ void testBalancedSign() {
 	testSign<b256>("Ed25519");
 }
 
+void testBalancedSignInPlace() {
+	testSignInPlace<b256>("Ed25519");
+}
+
 void testBalancedVerify() {
 	testVerify<b256>("Ed25519");
 }
@@ -220,21 +299,1442 @@ void testFastSign() {
 	testSign<b176>("E-168");
 }
 
+void testFastSignInPlace() {
+	testSignInPlace<b176>("E-168");
+}
+
 void testFastVerify() {
 	testVerify<b176>("E-168");
 }
 
+void testHashing() {
+	const int HASH_COUNT = 100 * LOOP_COUNT;
+	b256 hash;
+
+	uint64_t t0 = ecrp::getTimestampUTC();
+	cout << "Hashing " << HASH_COUNT << " messages with SHA-256..." << endl;
+	for (int i = 0; i < HASH_COUNT; i++) {
+		hash = sha256(COMMON_MSG.c_str(), COMMON_MSG.size());
+	}
+	uint64_t dt = std::max<uint64_t>(1, ecrp::getTimestampUTC() - t0);
+	double n = (double)(1000 * (uint64_t)HASH_COUNT) / dt;
+	cout << "Done in " << dt << " ms. (" << std::setprecision(6) << n << " hashes/s)" << endl;
+
+	b256 expected;
+	gcry_md_hash_buffer(GCRY_MD_SHA256, expected.b, COMMON_MSG.c_str(), COMMON_MSG.size());
+	check(memcmp(hash.b, expected.b, sizeof(hash.b)) == 0, "sha256 gives the digest of libgcrypt");
+}
+
+void testMultiHashing() {
+	using namespace ecrp::crypto::multisha256;
+
+	const size_t MESSAGE_COUNT = 50000;
+	const int ROUND_COUNT = 40;
+	const size_t LANE_COUNTS[] = { 1, 4, 8 };
+
+	std::vector<byte> data(MESSAGE_COUNT + 512);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (byte)(i * 131 + 7);
+	}
+
+	// every kernel the CPU can run must give the digests of libgcrypt, whatever the message length
+	std::vector<HashInput> inputs(301);
+	for (size_t i = 0; i < inputs.size(); i++) {
+		inputs[i].pData = data.data() + i % 64;
+		inputs[i].size = i;
+	}
+	std::vector<b256> outputs(inputs.size());
+	for (size_t l = 0; l < 3 && LANE_COUNTS[l] <= getMaxLaneCount(); l++) {
+		hashMessages(inputs.data(), outputs.data(), inputs.size(), LANE_COUNTS[l]);
+		bool isMatching = true;
+		for (size_t i = 0; i < inputs.size(); i++) {
+			b256 expected;
+			gcry_md_hash_buffer(GCRY_MD_SHA256, expected.b, inputs[i].pData, inputs[i].size);
+			isMatching &= memcmp(outputs[i].b, expected.b, sizeof(expected.b)) == 0;
+		}
+		check(isMatching, "sha256_many gives the digests of libgcrypt " + std::to_string(LANE_COUNTS[l]) + " at a time");
+	}
+
+	// from a midstate, every message being the rest of a prefix of which only the full blocks were compressed
+	const size_t PREFIX_SIZES[] = { 0, 50, 64, 150 };
+	for (size_t p = 0; p < 4; p++) {
+		Sha256Midstate midstate;
+		sha256_midstate(data.data(), PREFIX_SIZES[p], midstate);
+		check(midstate.size == PREFIX_SIZES[p] - PREFIX_SIZES[p] % 64, "sha256_midstate compresses the full blocks of the prefix");
+
+		std::vector<HashInput> suffixes(130);
+		for (size_t i = 0; i < suffixes.size(); i++) {
+			suffixes[i].pData = data.data() + midstate.size;
+			suffixes[i].size = i;
+		}
+		for (size_t l = 0; l < 3 && LANE_COUNTS[l] <= getMaxLaneCount(); l++) {
+			hashMessages(suffixes.data(), outputs.data(), suffixes.size(), LANE_COUNTS[l], &midstate);
+			bool isMatching = true;
+			for (size_t i = 0; i < suffixes.size(); i++) {
+				b256 expected;
+				gcry_md_hash_buffer(GCRY_MD_SHA256, expected.b, data.data(), (size_t)midstate.size + i);
+				isMatching &= memcmp(outputs[i].b, expected.b, sizeof(expected.b)) == 0;
+			}
+			check(isMatching, "sha256_many gives the digests of libgcrypt from a midstate " + std::to_string(LANE_COUNTS[l]) + " at a time");
+		}
+	}
+
+	// the size of two Merkle tree nodes
+	inputs.resize(MESSAGE_COUNT);
+	outputs.resize(MESSAGE_COUNT);
+	for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+		inputs[i].pData = data.data() + i;
+		inputs[i].size = 2 * sizeof(b256);
+	}
+	for (size_t l = 0; l < 3 && LANE_COUNTS[l] <= getMaxLaneCount(); l++) {
+		uint64_t t0 = ecrp::getTimestampUTC();
+		cout << "Hashing " << MESSAGE_COUNT * ROUND_COUNT << " messages with SHA-256, " << LANE_COUNTS[l] << " at a time..." << endl;
+		for (int i = 0; i < ROUND_COUNT; i++) {
+			hashMessages(inputs.data(), outputs.data(), MESSAGE_COUNT, LANE_COUNTS[l]);
+		}
+		uint64_t dt = std::max<uint64_t>(1, ecrp::getTimestampUTC() - t0);
+		double n = (double)(1000 * MESSAGE_COUNT * ROUND_COUNT) / dt;
+		cout << "Done in " << dt << " ms. (" << std::setprecision(6) << n << " hashes/s)" << endl;
+	}
+	cout << "sha256_many hashes " << getLaneCount() << " at a time on this CPU." << endl;
+}
+
+void testMerkleTree() {
+	using namespace ecrp::blockchain;
+
+	cout << "Checking the Merkle tree..." << endl;
+
+	std::vector<b256> leaves(33);
+	for (size_t i = 0; i < leaves.size(); i++) {
+		leaves[i] = sha256(&i, sizeof(i));
+	}
+
+	// appending leaves one by one must give the root of a tree built at once, around every power of two
+	const size_t LEAF_COUNTS[] = { 1, 2, 3, 4, 5, 9, 17, 33 };
+	for (size_t c = 0; c < 8; c++) {
+		std::vector<b256> subset(leaves.begin(), leaves.begin() + LEAF_COUNTS[c]);
+		MerkleTree built;
+		built.build(subset);
+		MerkleTree appended;
+		for (size_t i = 0; i < subset.size(); i++) {
+			appended.append(subset[i]);
+		}
+		check(appended.getLeafCount() == subset.size() && appended.getRoot().equals(built.getRoot()),
+			"MerkleTree::append gives the root of MerkleTree::build with " + std::to_string(LEAF_COUNTS[c]) + " leaves");
+	}
+
+	// the last node of an odd level is carried up as it is, not paired with itself
+	MerkleTree tree;
+	tree.build(std::vector<b256>(1, leaves[0]));
+	check(tree.getRoot().equals(leaves[0]), "MerkleTree::getRoot of a single leaf");
+
+	tree.build(std::vector<b256>(leaves.begin(), leaves.begin() + 3));
+	check(tree.getRoot().equals(MerkleTree::hashNodes(MerkleTree::hashNodes(leaves[0], leaves[1]), leaves[2])),
+		"MerkleTree::getRoot promotes the odd leaf of 3");
+
+	tree.build(std::vector<b256>(leaves.begin(), leaves.begin() + 5));
+	b256 left = MerkleTree::hashNodes(MerkleTree::hashNodes(leaves[0], leaves[1]), MerkleTree::hashNodes(leaves[2], leaves[3]));
+	check(tree.getRoot().equals(MerkleTree::hashNodes(left, leaves[4])), "MerkleTree::getRoot promotes the odd leaf of 5 up two levels");
+
+	check(MerkleTree().getRoot().equals(b256()), "MerkleTree::getRoot of an empty tree");
+
+	cout << "Done." << endl;
+}
+
+void testUtxoSet() {
+	using namespace ecrp::blockchain;
+
+	const size_t OUTPUT_COUNT = 20000;
+	const size_t PREFIX_COUNT = 64;
+	const size_t ADDRESS_COUNT = 3;
+	const uint32_t MASTER_BLOCK_ID = 1234;
+	const std::string SNAPSHOT_FILENAME = "utxo_test.dat";
+
+	cout << "Checking the UTXO set..." << endl;
+
+	// Only the first bytes of the source pick the home slot, so a few prefixes build long clusters,
+	// which the erasures below break up by shifting entries back.
+	std::mt19937_64 random(42);
+	vector<uint64_t> prefixes(PREFIX_COUNT);
+	for (size_t i = 0; i < PREFIX_COUNT; i++) {
+		prefixes[i] = random();
+	}
+
+	UtxoSet utxos;
+	vector<OutPoint> outPoints(OUTPUT_COUNT);
+	vector<TransactionOutput> outputs(OUTPUT_COUNT);
+	for (size_t i = 0; i < OUTPUT_COUNT; i++) {
+		memset(outPoints[i].source.b, 0, sizeof(outPoints[i].source.b));
+		memcpy(outPoints[i].source.b, &prefixes[i % PREFIX_COUNT], sizeof(uint64_t));
+		memcpy(outPoints[i].source.b + sizeof(uint64_t), &i, sizeof(uint32_t));
+		outPoints[i].outputId = (uint16_t)(i % 2);
+		outputs[i].amount = i + 1;
+		memset(outputs[i].address.b, (int)(i % ADDRESS_COUNT), sizeof(outputs[i].address.b));
+		check(utxos.insert(outPoints[i], outputs[i]), "UtxoSet::insert of a new output");
+	}
+	check(!utxos.insert(outPoints[0], outputs[0]), "UtxoSet::insert of an existing output");
+
+	vector<size_t> order(OUTPUT_COUNT);
+	for (size_t i = 0; i < OUTPUT_COUNT; i++) {
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), random);
+
+	vector<bool> isErased(OUTPUT_COUNT, false);
+	for (size_t k = 0; k < OUTPUT_COUNT / 2; k++) {
+		TransactionOutput output;
+		check(utxos.erase(outPoints[order[k]], &output) && output.amount == outputs[order[k]].amount, "UtxoSet::erase of an unspent output");
+		isErased[order[k]] = true;
+	}
+	check(!utxos.erase(outPoints[order[0]]), "UtxoSet::erase of a spent output");
+	check(utxos.size() == OUTPUT_COUNT - OUTPUT_COUNT / 2, "UtxoSet::size after the erasures");
+
+	vector<uint64_t> balances(ADDRESS_COUNT, 0);
+	for (size_t i = 0; i < OUTPUT_COUNT; i++) {
+		TransactionOutput output;
+		bool isFound = utxos.find(outPoints[i], output);
+		check(isFound == !isErased[i] && (!isFound || output.amount == outputs[i].amount), "UtxoSet::find after the erasures");
+		if (!isErased[i]) {
+			balances[i % ADDRESS_COUNT] += outputs[i].amount;
+		}
+	}
+
+	utxos.save(SNAPSHOT_FILENAME, MASTER_BLOCK_ID);
+	UtxoSet loaded;
+	uint32_t masterBlockId = 0;
+	check(loaded.load(SNAPSHOT_FILENAME, masterBlockId) && masterBlockId == MASTER_BLOCK_ID, "UtxoSet::load of a snapshot");
+	check(loaded.size() == utxos.size(), "UtxoSet::size after a snapshot round trip");
+	for (size_t i = 0; i < OUTPUT_COUNT; i++) {
+		TransactionOutput output;
+		bool isFound = loaded.find(outPoints[i], output);
+		check(isFound == !isErased[i] && (!isFound || output.amount == outputs[i].amount), "UtxoSet::find after a snapshot round trip");
+	}
+	for (size_t i = 0; i < ADDRESS_COUNT; i++) {
+		check(loaded.getBalance(outputs[i].address) == balances[i], "UtxoSet::getBalance after a snapshot round trip");
+	}
+	boost::filesystem::remove(SNAPSHOT_FILENAME);
+
+	cout << "Done." << endl;
+}
+
+MasterBlock* createRewardMasterBlock(uint32_t id, const b120& address) {
+	using namespace ecrp::blockchain;
+
+	MasterBlock* mb = new MasterBlock(id, 1000 + id);
+	Block* b = new Block(1000 + id);
+	RewardTransaction t;
+	TransactionOutput o;
+	o.amount = 100 + id;
+	o.address = address;
+	t.addOutput(o);
+	b->addTransaction(t);
+	mb->addBlock(b);
+	return mb;
+}
+
+ecrp::blockchain::BasicTransaction createSignedTransaction(const BalancedPrivateKey& key, const b120& source, uint16_t sourceOutputId, uint64_t amount, const b120& address) {
+	using namespace ecrp::blockchain;
+
+	BasicTransaction t;
+	TransactionInput input;
+	input.source = source;
+	input.sourceOutputId = sourceOutputId;
+	input.publicKey = key.q;
+	t.setInput(input);
+	TransactionOutput o;
+	o.amount = amount;
+	o.address = address;
+	t.addOutput(o);
+
+	vector<byte> buffer;
+	b256 message = t.getSigningHash(buffer);
+	BalancedSignature signature;
+	signData(&message, sizeof(message), key, signature);
+	input.signatureR = signature.r;
+	input.signatureS = signature.s;
+	t.setInput(input);
+	return t;
+}
+
+void testValidateBlock() {
+	using namespace ecrp::blockchain;
+
+	const uint16_t TRANSACTION_COUNT = 200;
+	const uint16_t CORRUPTED_INDEX = 137;
+	const uint32_t THREAD_COUNT = 4;
+
+	cout << "Checking the signatures of a block..." << endl;
+
+	BalancedPrivateKey key;
+	generateKey(key);
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+
+	// a reward transaction comes first, so that the index of a transaction is not the one of its input
+	auto createBlock = [&](uint16_t blockIndex, bool isCorrupted) {
+		Block* b = new Block(1000 + blockIndex);
+		RewardTransaction reward;
+		TransactionOutput o;
+		o.amount = 100;
+		o.address = address;
+		reward.addOutput(o);
+		b->addTransaction(reward);
+		for (uint16_t i = 1; i <= TRANSACTION_COUNT; i++) {
+			b120 source;
+			memset(source.b, 0, sizeof(source.b));
+			memcpy(source.b, &i, sizeof(i));
+			memcpy(source.b + sizeof(i), &blockIndex, sizeof(blockIndex));
+			BasicTransaction t = createSignedTransaction(key, source, 0, i, address);
+			if (isCorrupted && i == CORRUPTED_INDEX) {
+				TransactionInput input = t.getInput();
+				input.signatureS.b[0] ^= 1;
+				t.setInput(input);
+			}
+			b->addTransaction(t);
+		}
+		return b;
+	};
+
+	BlockValidator validator;
+	validator.setThreadCount(THREAD_COUNT);
+	try {
+		std::unique_ptr<Block> b(createBlock(0, false));
+		validator.validate(*b);
+
+		MasterBlock mb(1, 1000);
+		mb.addBlock(createBlock(0, false));
+		mb.addBlock(createBlock(1, false));
+		validator.validate(mb);
+	} catch (const std::exception& e) {
+		check(false, std::string("BlockValidator::validate of valid signatures threw: ") + e.what());
+	}
+
+	std::string expected = "transaction '" + std::to_string(CORRUPTED_INDEX) + "'";
+	try {
+		std::unique_ptr<Block> b(createBlock(0, true));
+		validator.validate(*b);
+		check(false, "BlockValidator::validate of a block with an invalid signature");
+	} catch (const std::exception& e) {
+		check(std::string(e.what()).find(expected) != std::string::npos, "BlockValidator::validate reports the transaction with an invalid signature");
+	}
+
+	try {
+		MasterBlock mb(1, 1000);
+		mb.addBlock(createBlock(0, false));
+		mb.addBlock(createBlock(1, true));
+		mb.addBlock(createBlock(2, false));
+		validator.validate(mb);
+		check(false, "BlockValidator::validate of a MasterBlock with an invalid signature");
+	} catch (const std::exception& e) {
+		check(std::string(e.what()).find(expected + " of block '1'") != std::string::npos, "BlockValidator::validate reports the block and the transaction with an invalid signature");
+	}
+
+	cout << "Done." << endl;
+}
+
+void testSignatureCache() {
+	using namespace ecrp::blockchain;
+
+	const size_t MAX_SIZE = 160;
+	const uint32_t KEY_COUNT = 10000;
+
+	cout << "Checking the signature cache..." << endl;
+
+	// every shard forgets its oldest keys once full, so the cache never holds more than its size
+	SignatureCache cache;
+	cache.setMaxSize(MAX_SIZE);
+	vector<b256> keys;
+	for (uint32_t i = 0; i < KEY_COUNT; i++) {
+		keys.push_back(sha256(&i, sizeof(i)));
+		cache.insert(keys.back());
+	}
+	check(cache.size() <= MAX_SIZE, "SignatureCache::size is bounded by the maximum size");
+	check(!cache.contains(keys.front()) && cache.contains(keys.back()), "SignatureCache::insert forgets the oldest keys");
+	size_t size = cache.size();
+	check(cache.contains(keys.back(), true) && !cache.contains(keys.back()) && cache.size() == size - 1, "SignatureCache::contains erases a key found");
+
+	// a key erased and inserted again is as recent as its last insertion, the keys below all falling in one shard
+	const size_t SHARD_SIZE = MAX_SIZE / 16;
+	cache.clear();
+	vector<b256> shardKeys(SHARD_SIZE + 1);
+	for (size_t i = 0; i < shardKeys.size(); i++) {
+		shardKeys[i] = sha256(&i, sizeof(i));
+		shardKeys[i].b[0] = 0;
+	}
+	cache.insert(shardKeys[0]);
+	cache.contains(shardKeys[0], true);
+	cache.insert(shardKeys[0]);
+	for (size_t i = 1; i < SHARD_SIZE; i++) {
+		cache.insert(shardKeys[i]);
+	}
+	check(cache.contains(shardKeys[0]) && cache.size() == SHARD_SIZE, "SignatureCache::insert keeps a key inserted again after being erased");
+	cache.insert(shardKeys[SHARD_SIZE]);
+	check(!cache.contains(shardKeys[0]) && cache.contains(shardKeys[1]) && cache.size() == SHARD_SIZE, "SignatureCache::insert forgets a key inserted again once it is the oldest");
+
+	// a signature verified for the mempool is not verified again in a MasterBlock until it is forgotten
+	BalancedPrivateKey key;
+	generateKey(key);
+	b120 source;
+	memset(source.b, 2, sizeof(source.b));
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	BasicTransaction t = createSignedTransaction(key, source, 0, 100, address);
+	Block* b = new Block(1000);
+	b->addTransaction(t);
+	MasterBlock mb(1, 1000);
+	mb.addBlock(b);
+
+	BlockValidator validator;
+	check(validator.verify(t) && validator.getVerifiedCount() == 1, "BlockValidator::verify of a new signature");
+	vector<b256> cachedKeys;
+	validator.validate(mb, &cachedKeys);
+	check(validator.getVerifiedCount() == 1 && cachedKeys.size() == 1, "BlockValidator::validate skips a cached signature");
+	cachedKeys.clear();
+	validator.validate(mb, &cachedKeys);
+	check(validator.getVerifiedCount() == 1 && cachedKeys.size() == 1, "BlockValidator::validate leaves the cached signatures in the cache");
+	validator.forgetSignatures(cachedKeys);
+	validator.validate(mb);
+	check(validator.getVerifiedCount() == 2, "BlockValidator::validate of a forgotten signature");
+
+	cout << "Done." << endl;
+}
+
+void testMempool() {
+	using namespace ecrp::blockchain;
+
+	const uint16_t OUTPUT_COUNT = 20;
+	const uint64_t INPUT_AMOUNT = 1000;
+	const size_t BLOCK_TRANSACTION_COUNT = 5;
+
+	cout << "Checking the mempool..." << endl;
+
+	BalancedPrivateKey key;
+	generateKey(key);
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	b120 source;
+	memset(source.b, 2, sizeof(source.b));
+
+	UtxoSet utxos;
+	for (uint16_t i = 0; i < OUTPUT_COUNT; i++) {
+		OutPoint outPoint;
+		outPoint.source = source;
+		outPoint.outputId = i;
+		TransactionOutput output;
+		output.amount = INPUT_AMOUNT;
+		output.address = address;
+		utxos.insert(outPoint, output);
+	}
+
+	// the transactions have the same size, and the one spending output i pays a fee of i + 1
+	vector<BasicTransaction> transactions;
+	for (uint16_t i = 0; i < OUTPUT_COUNT; i++) {
+		transactions.push_back(createSignedTransaction(key, source, i, INPUT_AMOUNT - (i + 1), address));
+	}
+
+	BlockValidator validator;
+	Mempool mempool(&utxos);
+	mempool.setValidator(&validator);
+	bool isAdded = true;
+	for (uint16_t i = 0; i < OUTPUT_COUNT; i++) {
+		isAdded &= mempool.add(transactions[i]);
+	}
+	check(isAdded && mempool.size() == OUTPUT_COUNT, "Mempool::add of valid transactions");
+
+	b120 otherSource;
+	memset(otherSource.b, 3, sizeof(otherSource.b));
+	BasicTransaction forged = createSignedTransaction(key, source, OUTPUT_COUNT, 1, address);
+	TransactionInput input = forged.getInput();
+	input.signatureR.b[0] ^= 1;
+	forged.setInput(input);
+	check(!mempool.add(transactions[0]), "Mempool::add of a pooled transaction");
+	check(!mempool.add(createSignedTransaction(key, source, 0, 1, address)), "Mempool::add of a transaction spending a pooled output");
+	check(!mempool.add(createSignedTransaction(key, otherSource, 0, 1, address)), "Mempool::add of a transaction spending a missing output");
+	check(!mempool.add(createSignedTransaction(key, source, OUTPUT_COUNT, INPUT_AMOUNT, address)) && !mempool.add(createSignedTransaction(key, source, OUTPUT_COUNT, INPUT_AMOUNT + 1, address)), "Mempool::add of a transaction paying no fee");
+	check(!mempool.add(forged), "Mempool::add of a transaction with an invalid signature");
+	check(!mempool.add(RewardTransaction()), "Mempool::add of a reward transaction");
+	check(mempool.size() == OUTPUT_COUNT, "Mempool::size after the rejected transactions");
+
+	// highest fee density first, up to the size asked
+	size_t transactionSize = transactions[0].serializedSize();
+	vector<TransactionVariant> selected;
+	mempool.getTransactionsForBlock(BLOCK_TRANSACTION_COUNT * transactionSize, selected);
+	bool isOrdered = selected.size() == BLOCK_TRANSACTION_COUNT;
+	for (size_t i = 0; i < selected.size() && isOrdered; i++) {
+		isOrdered = getTransactionInput(selected[i])->sourceOutputId == OUTPUT_COUNT - 1 - i;
+	}
+	check(isOrdered, "Mempool::getTransactionsForBlock by fee density");
+
+	// the transactions paying the least are evicted first
+	size_t entryUsage = mempool.getUsage() / OUTPUT_COUNT;
+	mempool.setMaxUsage(entryUsage * OUTPUT_COUNT / 2);
+	bool isEvicted = mempool.size() == OUTPUT_COUNT / 2 && mempool.getUsage() <= entryUsage * OUTPUT_COUNT / 2;
+	for (uint16_t i = 0; i < OUTPUT_COUNT; i++) {
+		isEvicted &= mempool.contains(getTransactionId(transactions[i])) == (i >= OUTPUT_COUNT / 2);
+	}
+	check(isEvicted, "Mempool::setMaxUsage evicts the lowest fee densities");
+	mempool.setMaxUsage(entryUsage * OUTPUT_COUNT * 2);
+
+	// a block takes its transactions out of the pool along with those spending the same outputs
+	MasterBlock mb(1, 1000);
+	Block* b = new Block(1000);
+	b->addTransaction(transactions[OUTPUT_COUNT - 1]);
+	b->addTransaction(createSignedTransaction(key, source, OUTPUT_COUNT - 2, 1, address));
+	mb.addBlock(b);
+	vector<b120> ids;
+	validator.checkSpends(mb, utxos, ids);
+	UtxoUndo undo;
+	utxos.applyMasterBlock(mb, ids, undo);
+	mempool.removeForMasterBlock(mb);
+	check(mempool.size() == OUTPUT_COUNT / 2 - 2 && !mempool.contains(getTransactionId(transactions[OUTPUT_COUNT - 2])), "Mempool::removeForBlock of included and conflicting transactions");
+
+	// once the MasterBlock is disconnected, its transactions come back and those spending its outputs go
+	BasicTransaction child = createSignedTransaction(key, ids[0], 0, 1, address);
+	check(mempool.add(child), "Mempool::add of a transaction spending a connected output");
+	utxos.revert(undo);
+	mempool.restoreForMasterBlock(mb, undo);
+	check(!mempool.contains(getTransactionId(child)) && mempool.contains(ids[0]) && mempool.contains(ids[1]) && mempool.size() == OUTPUT_COUNT / 2, "Mempool::restoreForMasterBlock");
+
+	cout << "Done." << endl;
+}
+
+// Tells whether checking the spends of a MasterBlock made of one block per transaction throws with the given reason.
+bool isSpendRejected(const ecrp::blockchain::BlockValidator& validator, const ecrp::blockchain::UtxoSet& utxos, const vector<ecrp::blockchain::TransactionVariant>& transactions, const std::string& reason) {
+	using namespace ecrp::blockchain;
+
+	MasterBlock mb(1, 1000);
+	for (size_t i = 0; i < transactions.size(); i++) {
+		Block* b = new Block(1000);
+		b->addTransaction(transactions[i]);
+		mb.addBlock(b);
+	}
+	try {
+		vector<b120> ids;
+		validator.checkSpends(mb, utxos, ids);
+		return reason.empty() && ids.size() == transactions.size();
+	} catch (const std::exception& e) {
+		return !reason.empty() && std::string(e.what()).find(reason) != std::string::npos;
+	}
+}
+
+void testCheckSpends() {
+	using namespace ecrp::blockchain;
+
+	const uint16_t OUTPUT_COUNT = 4;
+	const uint64_t INPUT_AMOUNT = 1000;
+	const uint32_t THREAD_COUNT = 4;
+
+	cout << "Checking the spends of a MasterBlock..." << endl;
+
+	BalancedPrivateKey key;
+	generateKey(key);
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	b120 source;
+	memset(source.b, 2, sizeof(source.b));
+	b120 missingSource;
+	memset(missingSource.b, 3, sizeof(missingSource.b));
+
+	UtxoSet utxos;
+	for (uint16_t i = 0; i < OUTPUT_COUNT; i++) {
+		OutPoint outPoint;
+		outPoint.source = source;
+		outPoint.outputId = i;
+		TransactionOutput output;
+		output.amount = INPUT_AMOUNT;
+		output.address = address;
+		utxos.insert(outPoint, output);
+	}
+
+	BlockValidator validator;
+	validator.setThreadCount(THREAD_COUNT);
+
+	// an output created earlier in the MasterBlock can be spent by a later transaction
+	BasicTransaction parent = createSignedTransaction(key, source, 0, INPUT_AMOUNT - 1, address);
+	BasicTransaction child = createSignedTransaction(key, getTransactionId(parent), 0, INPUT_AMOUNT - 2, address);
+	vector<TransactionVariant> transactions;
+	transactions.push_back(parent);
+	transactions.push_back(createSignedTransaction(key, source, 1, INPUT_AMOUNT - 1, address));
+	transactions.push_back(child);
+	check(isSpendRejected(validator, utxos, transactions, ""), "BlockValidator::checkSpends of valid spends");
+
+	transactions.clear();
+	transactions.push_back(createSignedTransaction(key, source, 1, INPUT_AMOUNT - 1, address));
+	transactions.push_back(parent);
+	transactions.push_back(createSignedTransaction(key, source, 1, INPUT_AMOUNT - 2, address));
+	check(isSpendRejected(validator, utxos, transactions, "spends an output already spent"), "BlockValidator::checkSpends of a double spend");
+
+	transactions.clear();
+	transactions.push_back(child);
+	transactions.push_back(parent);
+	check(isSpendRejected(validator, utxos, transactions, "spends an output created after it"), "BlockValidator::checkSpends of an output spent before it is created");
+
+	transactions.clear();
+	transactions.push_back(parent);
+	transactions.push_back(createSignedTransaction(key, missingSource, 0, INPUT_AMOUNT - 1, address));
+	check(isSpendRejected(validator, utxos, transactions, "spends a missing output"), "BlockValidator::checkSpends of a missing output");
+
+	// identical reward transactions in two blocks share their txid, so they would create the same outputs
+	RewardTransaction reward;
+	TransactionOutput o;
+	o.amount = 100;
+	o.address = address;
+	reward.addOutput(o);
+	transactions.clear();
+	transactions.push_back(reward);
+	transactions.push_back(parent);
+	transactions.push_back(reward);
+	check(isSpendRejected(validator, utxos, transactions, "is duplicated"), "BlockValidator::checkSpends of a duplicated transaction");
+
+	cout << "Done." << endl;
+}
+
+bool hasMasterBlocks(Blockchain& blockchain, uint32_t firstId, uint32_t lastId) {
+	for (uint32_t id = firstId; id <= lastId; id++) {
+		std::unique_ptr<MasterBlock> mb(blockchain.getMasterBlock(id));
+		if (!mb || mb->getId() != id) {
+			return false;
+		}
+	}
+	return true;
+}
+
+b120 createKey(uint32_t i, uint32_t salt) {
+	uint32_t values[2] = { i, salt };
+	b256 hash = sha256(values, sizeof(values));
+	b120 key;
+	memcpy(key.b, hash.b, sizeof(key.b));
+	return key;
+}
+
+void testBlockFilter() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t OUTPUT_COUNT = 300;
+	const uint32_t INPUT_COUNT = 100;
+	const uint32_t UNRELATED_COUNT = 2000;
+	const uint32_t MASTER_BLOCK_COUNT = 40;
+	const char* DIRECTORY = "filter_test";
+
+	cout << "Checking the block filters..." << endl;
+
+	// the inputs are not signed, which the filter does not look at
+	Block b(1000);
+	RewardTransaction reward;
+	for (uint32_t i = 0; i < OUTPUT_COUNT; i++) {
+		TransactionOutput o;
+		o.amount = 1;
+		o.address = createKey(i, 1);
+		reward.addOutput(o);
+	}
+	b.addTransaction(reward);
+	for (uint32_t i = 0; i < INPUT_COUNT; i++) {
+		BasicTransaction t;
+		TransactionInput input;
+		input.source = createKey(i, 2);
+		input.sourceOutputId = 0;
+		t.setInput(input);
+		TransactionOutput o;
+		o.amount = 1;
+		o.address = createKey(i, 3);
+		t.addOutput(o);
+		b.addTransaction(t);
+	}
+
+	BlockFilter filter;
+	filter.build(b);
+	bool isContained = true;
+	for (uint32_t i = 0; i < OUTPUT_COUNT; i++) {
+		isContained &= filter.mayContain(createKey(i, 1));
+	}
+	for (uint32_t i = 0; i < INPUT_COUNT; i++) {
+		isContained &= filter.mayContain(createKey(i, 2)) && filter.mayContain(createKey(i, 3));
+	}
+	check(isContained, "BlockFilter::mayContain of every address and source of the block");
+
+	uint32_t falsePositiveCount = 0;
+	for (uint32_t i = 0; i < UNRELATED_COUNT; i++) {
+		falsePositiveCount += filter.mayContain(createKey(i, 4)) ? 1 : 0;
+	}
+	check(falsePositiveCount < UNRELATED_COUNT / 20, "BlockFilter::mayContain of unrelated keys is mostly false");
+
+	// a filter whose size runs past its record is rejected before its bits are allocated
+	vector<byte> buffer(filter.serializedSize());
+	be_ptr_ostream os(buffer.data(), buffer.size());
+	filter.serialize(os);
+	{
+		be_ptr_istream is(buffer.data(), buffer.size());
+		BlockFilter decoded;
+		decoded.deserialize(is);
+		check(decoded.mayContain(createKey(0, 1)) && is.get_remaining_size() == 0, "BlockFilter::deserialize of a serialized filter");
+	}
+	bool isThrown = false;
+	try {
+		be_ptr_istream is(buffer.data(), buffer.size() - 1);
+		BlockFilter decoded;
+		decoded.deserialize(is);
+	} catch (const std::exception&) {
+		isThrown = true;
+	}
+	check(isThrown, "BlockFilter::deserialize of a truncated filter");
+
+	vector<byte> corrupted(buffer);
+	memset(&corrupted[1], 0xFF, sizeof(uint32_t));
+	isThrown = false;
+	try {
+		be_ptr_istream is(corrupted.data(), corrupted.size());
+		BlockFilter decoded;
+		decoded.deserialize(is);
+	} catch (const std::exception&) {
+		isThrown = true;
+	}
+	check(isThrown, "BlockFilter::deserialize of a filter larger than its record");
+
+	corrupted = buffer;
+	corrupted[0] = 0;
+	isThrown = false;
+	try {
+		be_ptr_istream is(corrupted.data(), corrupted.size());
+		BlockFilter decoded;
+		decoded.deserialize(is);
+	} catch (const std::exception&) {
+		isThrown = true;
+	}
+	check(isThrown, "BlockFilter::deserialize of a filter without hashes");
+
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		Blockchain blockchain;
+		blockchain.init();
+		for (uint32_t id = 0; id < MASTER_BLOCK_COUNT; id++) {
+			blockchain.addMasterBlock(createRewardMasterBlock(id, createKey(id, 5)));
+		}
+
+		bool isFound = true;
+		for (uint32_t id = 0; id < MASTER_BLOCK_COUNT; id++) {
+			vector<BlockReference> blocks;
+			blockchain.findBlocks(vector<b120>(1, createKey(id, 5)), blocks);
+			bool isListed = false;
+			for (size_t i = 0; i < blocks.size(); i++) {
+				isListed |= blocks[i].masterBlockId == id && blocks[i].blockIndex == 0;
+			}
+			isFound &= isListed;
+		}
+		check(isFound, "Blockchain::findBlocks lists the block paying an address");
+
+		vector<b120> keys;
+		for (uint32_t i = 0; i < 10; i++) {
+			keys.push_back(createKey(i, 6));
+		}
+		vector<BlockReference> blocks;
+		blockchain.findBlocks(keys, blocks);
+		check(blocks.size() < MASTER_BLOCK_COUNT / 10, "Blockchain::findBlocks skips most blocks for unrelated keys");
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the block filters threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+bool isSameOutputs(const ecrp::blockchain::TransactionOutputs& a, const ecrp::blockchain::TransactionOutputs& b) {
+	bool isSame = a.size() == b.size();
+	for (size_t k = 0; isSame && k < a.size(); k++) {
+		isSame = a[k].amount == b[k].amount && memcmp(a[k].address.b, b[k].address.b, sizeof(a[k].address.b)) == 0;
+	}
+	return isSame;
+}
+
+void testBlockSerialization() {
+	using namespace ecrp::blockchain;
+
+	cout << "Checking the block serialization..." << endl;
+
+	Block b(1234);
+	RewardTransaction reward;
+	FeeTransaction fee;
+	for (uint32_t i = 0; i < 3; i++) {
+		TransactionOutput o;
+		o.amount = 1000 + i;
+		o.address = createKey(i, 7);
+		reward.addOutput(o);
+		o.amount = 10 + i;
+		fee.addOutput(o);
+	}
+	b.addTransaction(reward);
+	for (uint32_t i = 0; i < 5; i++) {
+		BasicTransaction t;
+		TransactionInput input;
+		input.source = createKey(i, 8);
+		input.sourceOutputId = (uint16_t)i;
+		memset(input.signatureR.b, 1 + i, sizeof(input.signatureR.b));
+		memset(input.signatureS.b, 2 + i, sizeof(input.signatureS.b));
+		memset(input.publicKey.b, 3 + i, sizeof(input.publicKey.b));
+		t.setInput(input);
+		for (uint32_t k = 0; k <= i; k++) {
+			TransactionOutput o;
+			o.amount = 100 * i + k;
+			o.address = createKey(k, 9);
+			t.addOutput(o);
+		}
+		b.addTransaction(t);
+	}
+	b.addTransaction(fee);
+
+	vector<byte> buffer(b.serializedSize());
+	be_ptr_ostream os(buffer.data(), buffer.size());
+	b.serialize(os);
+
+	// decoded on the heap and into an arena, which only changes where the outputs live
+	Arena arena;
+	Block heapBlock;
+	Block* decodedBlocks[2] = { &heapBlock, arena.create<Block>(&arena) };
+	for (size_t d = 0; d < 2; d++) {
+		const Block& decoded = *decodedBlocks[d];
+		const std::string where = (d == 0) ? " on the heap" : " into an arena";
+
+		be_ptr_istream is(buffer.data(), buffer.size());
+		decodedBlocks[d]->deserialize(is);
+		check(is.get_remaining_size() == 0, "Block::deserialize reads the whole block" + where);
+		check(decoded.getTransactionCount() == b.getTransactionCount() && memcmp(decoded.getRootHash().b, b.getRootHash().b, sizeof(b256)) == 0 && decoded.computeRootHash().equals(b.getRootHash()),
+			"Block::deserialize gives the transactions and root hash of the block" + where);
+
+		bool isSame = decoded.getTransactionCount() == b.getTransactionCount();
+		for (uint16_t i = 0; isSame && i < b.getTransactionCount(); i++) {
+			const TransactionVariant& expected = b.getTransaction(i);
+			const TransactionVariant& t = decoded.getTransaction(i);
+			isSame = getTransactionType(t) == getTransactionType(expected) && isSameOutputs(getTransactionOutputs(t), getTransactionOutputs(expected));
+
+			const TransactionInput* expectedInput = getTransactionInput(expected);
+			const TransactionInput* input = getTransactionInput(t);
+			if (isSame && expectedInput) {
+				isSame = input && memcmp(input->source.b, expectedInput->source.b, sizeof(input->source.b)) == 0 && input->sourceOutputId == expectedInput->sourceOutputId
+					&& memcmp(input->signatureR.b, expectedInput->signatureR.b, sizeof(input->signatureR.b)) == 0
+					&& memcmp(input->signatureS.b, expectedInput->signatureS.b, sizeof(input->signatureS.b)) == 0
+					&& memcmp(input->publicKey.b, expectedInput->publicKey.b, sizeof(input->publicKey.b)) == 0;
+			} else if (isSame) {
+				isSame = input == NULL;
+			}
+		}
+		check(isSame, "Block::deserialize gives the fields of the BASIC, FEE and REWARD transactions" + where);
+
+		vector<byte> reserialized(decoded.serializedSize());
+		be_ptr_ostream ros(reserialized.data(), reserialized.size());
+		decoded.serialize(ros);
+		check(reserialized == buffer, "Block::serialize of a decoded block gives the bytes it was decoded from" + where);
+	}
+
+	// a version 1 record has no block sizes, and keeps both its version and its layout when written again
+	b120 address = createKey(0, 10);
+	std::unique_ptr<MasterBlock> mb(createRewardMasterBlock(7, address));
+	Block* block = mb->getBlock(0);
+	vector<byte> legacy(sizeof(uint32_t) + sizeof(uint16_t) + 2 * sizeof(uint32_t) + sizeof(uint64_t) + 2 * sizeof(b256) + sizeof(uint16_t) + block->serializedSize());
+	be_ptr_ostream ls(legacy.data(), legacy.size());
+	ls << mb->getId() << (uint16_t)1 << mb->getTimestamp() << mb->getTarget() << mb->getNonce() << mb->getPreviousHash() << mb->getMasterHash() << (uint16_t)1;
+	block->serialize(ls);
+
+	MasterBlock decoded;
+	be_ptr_istream is(legacy.data(), legacy.size());
+	decoded.deserialize(is);
+	b256 hash = decoded.getHash();
+	check(decoded.getVersion() == 1 && is.get_remaining_size() == 0, "MasterBlock::deserialize of a version 1 record");
+
+	vector<byte> reserialized;
+	decoded.serialize(reserialized);
+	check(reserialized == legacy && decoded.serializedSize() == legacy.size(), "MasterBlock::serialize of a version 1 MasterBlock keeps its layout");
+
+	MasterBlock redecoded;
+	redecoded.deserialize(std::move(reserialized));
+	check(redecoded.getVersion() == 1 && redecoded.getHash().equals(hash), "MasterBlock::getHash after writing a version 1 MasterBlock again");
+
+	// a block which does not fill the size its record declares for it is rejected, eagerly and lazily
+	vector<byte> padded;
+	mb->serialize(padded);
+	const size_t blockSizeOffset = MasterBlock::HEADER_SIZE + sizeof(uint16_t);
+	be_ptr_istream ps(padded.data() + blockSizeOffset, sizeof(uint32_t));
+	uint32_t blockSize;
+	ps >> blockSize;
+	be_ptr_ostream pos(padded.data() + blockSizeOffset, sizeof(uint32_t));
+	pos << blockSize + 1;
+	padded.push_back(0);
+	for (int isLazy = 0; isLazy < 2; isLazy++) {
+		bool isThrown = false;
+		try {
+			MasterBlock corrupted;
+			be_ptr_istream cs(padded.data(), padded.size());
+			corrupted.deserialize(cs, isLazy != 0);
+			corrupted.getBlock(0);
+		} catch (const std::exception&) {
+			isThrown = true;
+		}
+		check(isThrown, std::string("MasterBlock::deserialize of a block shorter than its declared size") + (isLazy ? " in lazy mode" : ""));
+	}
+
+	cout << "Done." << endl;
+}
+
+void testSegments() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t LEGACY_COUNT = 20;
+	const uint32_t MASTER_BLOCK_COUNT = 60;
+	const uint64_t SEGMENT_SIZE = 512;
+	const uint32_t SNAPSHOT_INTERVAL = 10;
+	const char* DIRECTORY = "segments_test";
+	const char* INDEX_FILENAME = "blocks.idx";
+
+	cout << "Checking the chain segments..." << endl;
+
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	uint64_t balance = 0;
+
+	// the chain files have fixed names, so the test chain is written aside from the real one
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		{
+			Blockchain blockchain;
+			blockchain.setSnapshotInterval(SNAPSHOT_INTERVAL);
+			blockchain.init();
+			for (uint32_t id = 0; id < LEGACY_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+				balance += 100 + id;
+			}
+		}
+
+		// a chain written in a single file before segments were introduced becomes the first segment
+		boost::filesystem::remove("blocks.manifest");
+		boost::filesystem::remove(INDEX_FILENAME);
+		boost::filesystem::rename(SegmentManifest::getSegmentFilename(0), "blocks.dat");
+		{
+			Blockchain blockchain;
+			blockchain.setSegmentSize(SEGMENT_SIZE);
+			blockchain.setSnapshotInterval(SNAPSHOT_INTERVAL);
+			blockchain.init();
+			check(!boost::filesystem::exists("blocks.dat") && boost::filesystem::exists(SegmentManifest::getSegmentFilename(0)), "Blockchain::init migrates a single-file chain");
+			check(hasMasterBlocks(blockchain, 0, LEGACY_COUNT - 1), "Blockchain::getMasterBlock after a migration");
+			check(blockchain.getBalanceForAddress(address) == balance, "Blockchain::getBalanceForAddress after a migration");
+
+			for (uint32_t id = LEGACY_COUNT; id < MASTER_BLOCK_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+				balance += 100 + id;
+			}
+			check(boost::filesystem::exists(SegmentManifest::getSegmentFilename(2)), "Blockchain::addMasterBlock rolls over to new segments");
+		}
+
+		uint64_t indexSize;
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock across segments");
+			check(blockchain.getBalanceForAddress(address) == balance, "Blockchain::getBalanceForAddress across segments");
+			indexSize = boost::filesystem::file_size(INDEX_FILENAME);
+		}
+
+		// a lookup reads the manifest and the index itself, without the chain being loaded
+		{
+			Blockchain blockchain;
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock without Blockchain::init");
+			check(!std::unique_ptr<MasterBlock>(blockchain.getMasterBlock(MASTER_BLOCK_COUNT)), "Blockchain::getMasterBlock of an unknown MasterBlock without Blockchain::init");
+		}
+
+		// a missing index is rebuilt from the segments
+		boost::filesystem::remove(INDEX_FILENAME);
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(boost::filesystem::exists(INDEX_FILENAME) && boost::filesystem::file_size(INDEX_FILENAME) == indexSize, "Blockchain::init rebuilds the index");
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock after an index rebuild");
+		}
+
+		uint64_t prunedIndexSize;
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(blockchain.pruneSegments() > 0, "Blockchain::pruneSegments deletes the segments covered by the snapshot");
+			check(!boost::filesystem::exists(SegmentManifest::getSegmentFilename(0)), "Blockchain::pruneSegments deletes the first segment");
+			prunedIndexSize = boost::filesystem::file_size(INDEX_FILENAME);
+			check(prunedIndexSize < indexSize, "Blockchain::pruneSegments compacts the index");
+			check(!std::unique_ptr<MasterBlock>(blockchain.getMasterBlock(0)), "Blockchain::getMasterBlock of a pruned MasterBlock");
+			check(hasMasterBlocks(blockchain, MASTER_BLOCK_COUNT - 1, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock after pruning");
+		}
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(boost::filesystem::file_size(INDEX_FILENAME) == prunedIndexSize, "Blockchain::init keeps the compacted index");
+			check(hasMasterBlocks(blockchain, MASTER_BLOCK_COUNT - 1, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock after reloading a pruned chain");
+			check(blockchain.getBalanceForAddress(address) == balance, "Blockchain::getBalanceForAddress after reloading a pruned chain");
+		}
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the chain segments threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+void testUndoLog() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t RECORD_COUNT = 3;
+	const char* UNDO_FILENAME = "undo_test.dat";
+
+	cout << "Checking the undo log..." << endl;
+
+	boost::filesystem::remove(UNDO_FILENAME);
+	try {
+		UndoLog log(UNDO_FILENAME);
+		log.open();
+		for (uint32_t id = 0; id < RECORD_COUNT; id++) {
+			UtxoUndo undo;
+			OutPoint created;
+			memset(created.source.b, (int)id, sizeof(created.source.b));
+			created.outputId = (uint16_t)id;
+			undo.created.push_back(created);
+			log.append(id, undo);
+		}
+		log.close();
+		uint64_t size = boost::filesystem::file_size(UNDO_FILENAME);
+
+		// a record too short to hold its id is torn, whatever follows it
+		const byte shortRecord[] = { 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0 };
+		std::FILE* file = std::fopen(UNDO_FILENAME, "ab");
+		std::fwrite(shortRecord, sizeof(shortRecord), 1, file);
+		std::fclose(file);
+		log.open();
+		check(log.size() == RECORD_COUNT && boost::filesystem::file_size(UNDO_FILENAME) == size, "RecordLog::open of a record shorter than its id");
+
+		UtxoUndo undo;
+		log.append(RECORD_COUNT, undo);
+		bool isRead = true;
+		for (uint32_t id = 0; id < RECORD_COUNT; id++) {
+			isRead &= log.read(id, undo) && undo.created.size() == 1 && undo.created[0].outputId == id;
+		}
+		check(isRead && log.read(RECORD_COUNT, undo) && undo.created.empty(), "UndoLog::read after a torn record");
+		log.close();
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the undo log threw: ") + e.what());
+	}
+	boost::filesystem::remove(UNDO_FILENAME);
+
+	cout << "Done." << endl;
+}
+
+void testDisconnect() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t MASTER_BLOCK_COUNT = 60;
+	const uint32_t DISCONNECTED_COUNT = 35;
+	const uint64_t SEGMENT_SIZE = 512;
+	const uint32_t SNAPSHOT_INTERVAL = 10;
+	const char* DIRECTORY = "disconnect_test";
+
+	cout << "Checking the disconnection of MasterBlocks..." << endl;
+
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	vector<uint64_t> balances(1, 0);
+
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		{
+			Blockchain blockchain;
+			blockchain.setSegmentSize(SEGMENT_SIZE);
+			blockchain.setSnapshotInterval(SNAPSHOT_INTERVAL);
+			blockchain.init();
+			for (uint32_t id = 0; id < MASTER_BLOCK_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+				balances.push_back(balances.back() + 100 + id);
+			}
+		}
+
+		// the MasterBlocks covered by the snapshot are loaded lazily, from the mappings of segments which get cut off
+		uint32_t tipId = MASTER_BLOCK_COUNT - DISCONNECTED_COUNT - 1;
+		{
+			Blockchain blockchain;
+			blockchain.setSegmentSize(SEGMENT_SIZE);
+			blockchain.setSnapshotInterval(SNAPSHOT_INTERVAL);
+			blockchain.setLazyDecoding(true);
+			blockchain.init();
+			uint32_t lastSegment = 0;
+			while (boost::filesystem::exists(SegmentManifest::getSegmentFilename(lastSegment + 1))) {
+				lastSegment++;
+			}
+
+			bool isDisconnected = true;
+			for (uint32_t id = MASTER_BLOCK_COUNT; id > tipId + 1; id--) {
+				std::unique_ptr<MasterBlock> mb(blockchain.disconnectTip());
+				isDisconnected &= mb->getId() == id - 1 && blockchain.getBalanceForAddress(address) == balances[id - 1];
+			}
+			check(isDisconnected, "Blockchain::disconnectTip across segments");
+			check(blockchain.getHeaderChain().size() == tipId + 1, "HeaderChain::size after disconnecting MasterBlocks");
+			check(lastSegment > 1 && !boost::filesystem::exists(SegmentManifest::getSegmentFilename(lastSegment)), "Blockchain::disconnectTip drops the emptied segments");
+		}
+		{
+			Blockchain blockchain;
+			blockchain.setSegmentSize(SEGMENT_SIZE);
+			blockchain.setSnapshotInterval(SNAPSHOT_INTERVAL);
+			blockchain.init();
+			check(hasMasterBlocks(blockchain, 0, tipId) && !std::unique_ptr<MasterBlock>(blockchain.getMasterBlock(tipId + 1)), "Blockchain::getMasterBlock after disconnecting MasterBlocks");
+			check(blockchain.getBalanceForAddress(address) == balances[tipId + 1], "Blockchain::getBalanceForAddress after disconnecting MasterBlocks");
+
+			for (uint32_t id = tipId + 1; id < MASTER_BLOCK_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+			}
+		}
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock after reconnecting MasterBlocks");
+			check(blockchain.getBalanceForAddress(address) == balances[MASTER_BLOCK_COUNT], "Blockchain::getBalanceForAddress after reconnecting MasterBlocks");
+		}
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the disconnection of MasterBlocks threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+void testCommitFailure() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t MASTER_BLOCK_COUNT = 8;
+	const uint64_t SEGMENT_SIZE = 256;
+	const uint64_t SYNC_INTERVAL = 3600 * 1000;
+	const char* DIRECTORY = "commit_test";
+
+	cout << "Checking a failed group commit..." << endl;
+
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	vector<uint64_t> balances(1, 0);
+	for (uint32_t id = 0; id < MASTER_BLOCK_COUNT; id++) {
+		balances.push_back(balances.back() + 100 + id);
+	}
+
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		// The records stay pending until the snapshot of the last MasterBlock commits them. The second segment
+		// cannot be opened, so the records of the first one become durable and all the others are lost.
+		uint32_t durableCount = 0;
+		{
+			Blockchain blockchain;
+			blockchain.setSyncPolicy(SYNC_EVERY_N_MILLISECONDS, SYNC_INTERVAL);
+			blockchain.setSegmentSize(SEGMENT_SIZE);
+			blockchain.setSnapshotInterval(MASTER_BLOCK_COUNT);
+			blockchain.init();
+			boost::filesystem::create_directory(SegmentManifest::getSegmentFilename(1));
+
+			bool isThrown = false;
+			for (uint32_t id = 0; id < MASTER_BLOCK_COUNT; id++) {
+				MasterBlock* mb = createRewardMasterBlock(id, address);
+				try {
+					blockchain.addMasterBlock(mb);
+				} catch (const std::exception&) {
+					delete mb;
+					isThrown = true;
+				}
+			}
+			check(isThrown, "Blockchain::addMasterBlock reports a failed commit");
+
+			while (durableCount < MASTER_BLOCK_COUNT && std::unique_ptr<MasterBlock>(blockchain.getMasterBlock(durableCount))) {
+				durableCount++;
+			}
+			check(durableCount > 0 && durableCount + 1 < MASTER_BLOCK_COUNT, "A failed commit loses several pending MasterBlocks");
+			check(blockchain.getBalanceForAddress(address) == balances[durableCount], "Blockchain::getBalanceForAddress after a failed commit");
+			check(blockchain.getHeaderChain().size() == durableCount, "HeaderChain::size after a failed commit");
+
+			vector<b120> keys(1, address);
+			vector<BlockReference> blocks;
+			blockchain.findBlocks(keys, blocks);
+			check(blocks.size() == durableCount, "Blockchain::findBlocks after a failed commit");
+		}
+		boost::filesystem::remove_all(SegmentManifest::getSegmentFilename(1));
+
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			check(hasMasterBlocks(blockchain, 0, durableCount - 1) && blockchain.getBalanceForAddress(address) == balances[durableCount], "Blockchain::init after a failed commit");
+
+			for (uint32_t id = durableCount; id < MASTER_BLOCK_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+			}
+			check(blockchain.getBalanceForAddress(address) == balances[MASTER_BLOCK_COUNT], "Blockchain::addMasterBlock after a failed commit");
+		}
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking a failed group commit threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+void testCompression() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t MASTER_BLOCK_COUNT = 60;
+	const char* DIRECTORY = "compression_test";
+
+	cout << "Checking the chain compression..." << endl;
+
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+	uint64_t balance = 0;
+
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			for (uint32_t id = 0; id < MASTER_BLOCK_COUNT / 2; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+				balance += 100 + id;
+			}
+			uint64_t plainSize = boost::filesystem::file_size(SegmentManifest::getSegmentFilename(0));
+
+			blockchain.trainDictionary();
+			check(boost::filesystem::exists("blocks.dict"), "Blockchain::trainDictionary saves the dictionary");
+			blockchain.setCompression(true);
+			for (uint32_t id = MASTER_BLOCK_COUNT / 2; id < MASTER_BLOCK_COUNT; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+				balance += 100 + id;
+			}
+			uint64_t compressedSize = boost::filesystem::file_size(SegmentManifest::getSegmentFilename(0)) - plainSize;
+			check(compressedSize < plainSize, "Blockchain::setCompression compresses the new records");
+		}
+
+		// the records compressed with the dictionary are decoded after a reload, eagerly and lazily
+		for (int isLazy = 0; isLazy < 2; isLazy++) {
+			Blockchain blockchain;
+			blockchain.setLazyDecoding(isLazy != 0);
+			blockchain.init();
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock of compressed records");
+			check(blockchain.getBalanceForAddress(address) == balance, "Blockchain::getBalanceForAddress after loading compressed records");
+		}
+
+		// a lookup without the chain being loaded reads the dictionary itself
+		{
+			Blockchain blockchain;
+			check(hasMasterBlocks(blockchain, 0, MASTER_BLOCK_COUNT - 1), "Blockchain::getMasterBlock of compressed records without Blockchain::init");
+		}
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the chain compression threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+void testHeaderChain() {
+	using namespace ecrp::blockchain;
+
+	const uint32_t HEADER_COUNT = 100;
+	const char* HEADER_FILENAME = "headers_test.dat";
+	const char* DIRECTORY = "headers_test";
+
+	cout << "Checking the header chain..." << endl;
+
+	b120 address;
+	memset(address.b, 1, sizeof(address.b));
+
+	// ids and timestamps grow with gaps, so that the searches also look for values between two headers
+	boost::filesystem::remove(HEADER_FILENAME);
+	try {
+		HeaderChain headers(HEADER_FILENAME);
+		headers.open();
+		vector<b256> hashes;
+		b256 previousHash;
+		memset(previousHash.b, 0, sizeof(previousHash.b));
+		for (uint32_t i = 0; i < HEADER_COUNT; i++) {
+			MasterBlock mb(2 * i + 1, 1000 + 10 * i);
+			mb.setPreviousHash(previousHash);
+			headers.append(mb);
+			previousHash = mb.getHash();
+			hashes.push_back(previousHash);
+		}
+		check(headers.size() == HEADER_COUNT, "HeaderChain::size after the appends");
+
+		bool isFound = true;
+		for (uint32_t i = 0; i < HEADER_COUNT; i++) {
+			MasterBlockHeader header;
+			isFound &= headers.findById(2 * i + 1, header) && header.timestamp == 1000 + 10 * i && memcmp(header.hash.b, hashes[i].b, sizeof(header.hash.b)) == 0;
+			isFound &= !headers.findById(2 * i + 2, header);
+		}
+		MasterBlockHeader header;
+		check(isFound && !headers.findById(0, header), "HeaderChain::findById");
+
+		bool isPositioned = headers.findByTimestamp(0) == 0 && headers.findByTimestamp(1000 + 10 * HEADER_COUNT) == HEADER_COUNT;
+		for (uint32_t i = 0; i < HEADER_COUNT; i++) {
+			isPositioned &= headers.findByTimestamp(1000 + 10 * i) == i && headers.findByTimestamp(1000 + 10 * i - 5) == i;
+		}
+		check(isPositioned, "HeaderChain::findByTimestamp");
+
+		check(headers.validate() == HEADER_COUNT, "HeaderChain::validate of linked headers");
+		MasterBlock unlinked(2 * HEADER_COUNT + 1, 1000 + 10 * HEADER_COUNT);
+		headers.append(unlinked);
+		check(headers.validate() == HEADER_COUNT, "HeaderChain::validate of a header with another previous hash");
+		headers.truncate(HEADER_COUNT);
+		MasterBlock unmined(2 * HEADER_COUNT + 1, 1000 + 10 * HEADER_COUNT);
+		unmined.setPreviousHash(previousHash);
+		unmined.setTarget(8 * sizeof(previousHash.b));
+		headers.append(unmined);
+		check(headers.validate() == HEADER_COUNT, "HeaderChain::validate of a header without its proof of work");
+		headers.truncate(HEADER_COUNT);
+		check(headers.size() == HEADER_COUNT && headers.validate(HEADER_COUNT / 2) == HEADER_COUNT, "HeaderChain::truncate");
+
+		// a torn trailing header is cut off when the file is opened again
+		headers.close();
+		std::FILE* file = std::fopen(HEADER_FILENAME, "ab");
+		std::fwrite(hashes[0].b, HeaderChain::ENTRY_SIZE / 2, 1, file);
+		std::fclose(file);
+		headers.open();
+		check(headers.size() == HEADER_COUNT && boost::filesystem::file_size(HEADER_FILENAME) == HEADER_COUNT * HeaderChain::ENTRY_SIZE, "HeaderChain::open of a torn header");
+		headers.close();
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the header chain threw: ") + e.what());
+	}
+	boost::filesystem::remove(HEADER_FILENAME);
+
+	// The headers are not synced, so a crash may leave some for MasterBlocks whose records were lost,
+	// which the chain drops when it is loaded again.
+	boost::filesystem::path previousPath = boost::filesystem::current_path();
+	boost::filesystem::remove_all(DIRECTORY);
+	boost::filesystem::create_directory(DIRECTORY);
+	boost::filesystem::current_path(DIRECTORY);
+	try {
+		uint64_t durableSize;
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			for (uint32_t id = 0; id + 1 < HEADER_COUNT / 10; id++) {
+				blockchain.addMasterBlock(createRewardMasterBlock(id, address));
+			}
+		}
+		durableSize = boost::filesystem::file_size(SegmentManifest::getSegmentFilename(0));
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			blockchain.addMasterBlock(createRewardMasterBlock(HEADER_COUNT / 10 - 1, address));
+			check(blockchain.getHeaderChain().size() == HEADER_COUNT / 10, "HeaderChain::size after an append");
+		}
+		boost::filesystem::resize_file(SegmentManifest::getSegmentFilename(0), durableSize);
+		{
+			Blockchain blockchain;
+			blockchain.init();
+			MasterBlockHeader header;
+			check(blockchain.getHeaderChain().size() == HEADER_COUNT / 10 - 1 && !blockchain.getHeaderChain().findById(HEADER_COUNT / 10 - 1, header), "Blockchain::init drops the headers of lost MasterBlocks");
+
+			MasterBlock* mb = createRewardMasterBlock(HEADER_COUNT / 10 - 1, address);
+			b256 hash = mb->getHash();
+			blockchain.addMasterBlock(mb);
+			check(blockchain.getHeaderChain().findById(HEADER_COUNT / 10 - 1, header) && memcmp(header.hash.b, hash.b, sizeof(hash.b)) == 0, "HeaderChain::findById after a crash recovery");
+		}
+	} catch (const std::exception& e) {
+		check(false, std::string("Checking the header chain recovery threw: ") + e.what());
+	}
+	boost::filesystem::current_path(previousPath);
+	boost::filesystem::remove_all(DIRECTORY);
+
+	cout << "Done." << endl;
+}
+
+void testLoadBlockchain(uint32_t threadCount) {
+	cout << "Loading the blockchain with " << threadCount << " thread(s)..." << endl;
+	try {
+		Blockchain blockchain;
+		blockchain.setLoadingThreadCount(threadCount);
+		blockchain.init();
+		cout << "Done. (" << std::setprecision(6) << blockchain.getLoadingThroughput() << " MB/s)" << endl;
+	} catch (const std::exception& e) {
+		cerr << e.what() << endl;
+	}
+}
+
+void testSequentialLoad() {
+	testLoadBlockchain(1);
+}
+
+void testParallelLoad() {
+	testLoadBlockchain(std::max<uint32_t>(1, boost::thread::hardware_concurrency()));
+}
+
+void testMining() {
+	const uint32_t TARGET = 20;
+	cout << "Mining a MasterBlock with a " << TARGET << "-bit target..." << endl;
+	try {
+		MasterBlock mb(1, ecrp::getUnixTimestampUTC());
+		mb.setTarget(TARGET);
+		Miner miner;
+		bool isFound = miner.mine(mb, miner.getGeneration());
+		check(isFound && Miner::checkProofOfWork(mb), "Miner::mine finds a valid nonce");
+		cout << "Done. (nonce " << mb.getNonce() << ", " << std::setprecision(6) << miner.getHashRate() / 1000000.0 << " MH/s)" << endl;
+
+		// a cancellation between reading the generation and starting the search must not be lost
+		uint64_t generation = miner.getGeneration();
+		miner.cancel();
+		check(!miner.mine(mb, generation), "Miner::mine after a cancellation of its generation");
+	} catch (const std::exception& e) {
+		cerr << e.what() << endl;
+	}
+}
+
 int main(int argc, char *argv[]) {
 	testGCrypt256();
+	testHashing();
+	testMultiHashing();
 	testFastKeygen();
 	testFastSign();
+	testFastSignInPlace();
 	testFastVerify();
 	testBalancedKeygen();
 	testBalancedSign();
+	testBalancedSignInPlace();
 	testBalancedVerify();
 	testStrongKeygen();
 	testStrongSign();
+	testStrongSignInPlace();
 	testStrongVerify();
+	testMerkleTree();
+	testUtxoSet();
+	testValidateBlock();
+	testSignatureCache();
+	testMempool();
+	testCheckSpends();
+	testBlockFilter();
+	testBlockSerialization();
+	testSegments();
+	testUndoLog();
+	testDisconnect();
+	testCommitFailure();
+	testCompression();
+	testHeaderChain();
+	testSequentialLoad();
+	testParallelLoad();
+	testMining();
+	if (failureCount > 0) {
+		cerr << failureCount << " check(s) failed." << endl;
+	}
 	system("pause");
-	return 0;
+	return failureCount > 0 ? 1 : 0;
 }
\ No newline at end of file
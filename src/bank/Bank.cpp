@@ -16,6 +16,11 @@ namespace ecrp {
 	namespace bank {
 
 		Bank::Bank() {
+			_blockchain = NULL;
+		}
+
+		Bank::Bank(Blockchain* blockchain) {
+			_blockchain = blockchain;
 		}
 
 		Bank::~Bank() {
@@ -98,18 +103,20 @@ namespace ecrp {
 		}
 
 		int64_t Bank::getBalanceForAddress(string address) {
-			return 0; // TODO
-			/*return _blockchain->getBalanceForAddress(address);*/
+			if (_blockchain == NULL) {
+				throw Error("No blockchain attached to the bank.");
+			}
+			return (int64_t)_blockchain->getBalanceForAddress(b120(address));
 		}
 
 		Transaction* Bank::createTransaction(const string& walletId, const string& fromAddress, const string& toAddress, int64_t amount, const string& changeAddress) {
-			return 0; // TODO
-			/*Wallet* w = getWalletById(walletId);
-			if (w) {
-				return _blockchain->createTransaction(w->getPrivateKey(), fromAddress, toAddress, amount, changeAddress);
-			} else {
+			// Wallets derive Ed448 keys while transaction inputs carry Ed25519 ones, so no wallet can sign an input yet.
+			// Until they agree, this fails loudly rather than returning no transaction.
+			Wallet* w = getWalletById(walletId);
+			if (w == NULL) {
 				throw Error("Unable to find the wallet with id '%s'.", walletId.c_str());
-			}*/
+			}
+			throw Error("Creating a transaction from the wallet with id '%s' is not supported yet.", walletId.c_str());
 		}
 
 	}
@@ -5,12 +5,14 @@
 
 #include "crypto/Crypto.h"
 #include "blockchain/Transaction.h"
+#include "blockchain/Blockchain.h"
 #include "Wallet.h"
 
 using std::unordered_map;
 using std::string;
 using ecrp::crypto::b456;
 using ecrp::blockchain::Transaction;
+using ecrp::blockchain::Blockchain;
 
 //----------------------------------------------------------------------
 
@@ -22,10 +24,12 @@ namespace ecrp {
 		private: // MEMBERS
 
 			unordered_map<string, Wallet*> _wallets;
+			Blockchain* _blockchain;
 
 		public: // CONSTRUCTORS
 
 			Bank();
+			Bank(Blockchain* blockchain);
 
 			virtual ~Bank();
 
@@ -11,20 +11,23 @@ namespace ecrp {
 	namespace blockchain {
 
 		Block::Block() {
+			_arena = NULL;
 		}
 
 		Block::Block(uint32_t timestamp) {
+			_arena = NULL;
+			_version = CURRENT_VERSION;
 			_timestamp = timestamp;
 			_target = 0;
 			_nonce = 0;
-			memset(&_rootHash, 0, sizeof(_rootHash)); // TODO: create a dedicated function for that
+			_rootHash = b256(); // the root of an empty tree
+		}
+
+		Block::Block(Arena* arena) {
+			_arena = arena;
 		}
 
 		Block::~Block() {
-			for (uint16_t i = 0; i < _transactions.size(); ++i) {
-				delete _transactions[i];
-			}
-			_transactions.clear();
 		}
 
 		void Block::deserialize(be_ptr_istream& stream) {
@@ -41,15 +44,70 @@ namespace ecrp {
 
 			uint16_t transactionCount;
 			stream >> transactionCount;
+			_transactions.reserve(transactionCount);
 			for (uint16_t i = 0; i < transactionCount; ++i) {
-				Transaction* t = new Transaction();
-				t->deserialize(stream);
-				_transactions.push_back(t);
+				deserializeTransaction(stream, _transactions, _arena);
+			}
+		}
+
+		void Block::serialize(be_ptr_ostream& stream) const {
+			if (_transactions.size() > UINT16_MAX) {
+				throw runtime_error("Too many transactions in an ecrp::blockchain::Block.");
+			}
+
+			stream << (uint16_t)CURRENT_VERSION;
+			stream << _timestamp;
+			stream << _target;
+			stream << _nonce;
+			stream << _rootHash;
+
+			stream << (uint16_t)_transactions.size();
+			for (uint16_t i = 0; i < _transactions.size(); ++i) {
+				serializeTransaction(_transactions[i], stream);
 			}
 		}
 
-		void Block::addTransaction(Transaction* t) {
+		size_t Block::serializedSize() const {
+			size_t size = sizeof(_version) + sizeof(_timestamp) + sizeof(_target) + sizeof(_nonce) + sizeof(_rootHash) + sizeof(uint16_t);
+			for (uint16_t i = 0; i < _transactions.size(); ++i) {
+				size += getTransactionSerializedSize(_transactions[i]);
+			}
+			return size;
+		}
+
+		void Block::addTransaction(const TransactionVariant& t) {
+			if (!_merkleTree) {
+				_merkleTree.reset(new MerkleTree());
+				_merkleTree->build(_transactions); // empty unless the block was decoded
+			}
 			_transactions.push_back(t);
+			_merkleTree->append(t);
+			_rootHash = _merkleTree->getRoot();
+		}
+
+		b256 Block::computeRootHash() const {
+			MerkleTree tree;
+			tree.build(_transactions);
+			return tree.getRoot();
+		}
+
+		const b256& Block::getRootHash() const {
+			return _rootHash;
+		}
+
+		uint16_t Block::getTransactionCount() const {
+			return (uint16_t)_transactions.size();
+		}
+
+		const TransactionVariant& Block::getTransaction(uint16_t i) const {
+			if (i >= _transactions.size()) {
+				throw runtime_error("Invalid transaction index '" + std::to_string(i) + "' in an ecrp::blockchain::Block.");
+			}
+			return _transactions[i];
+		}
+
+		bool Block::isArenaAllocated() const {
+			return _arena != NULL;
 		}
 	}
 }
\ No newline at end of file
@@ -2,14 +2,19 @@
 #pragma once
 
 #include <vector>
+#include <memory>
 
 using std::vector;
 
 #include "utils/streams.h"
+#include "utils/arena.h"
 #include "crypto/Crypto.h"
-#include "Transaction.h"
+#include "TransactionVariant.h"
+#include "MerkleTree.h"
 
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::Arena;
 using ecrp::crypto::b256;
 
 //----------------------------------------------------------------------
@@ -31,20 +36,38 @@ namespace ecrp {
 			uint32_t _target;
 			uint64_t _nonce;
 			b256 _rootHash;
-			vector<Transaction*> _transactions;
+			vector<TransactionVariant> _transactions;
+			std::unique_ptr<MerkleTree> _merkleTree; // only for a block being filled, allocated by its first addTransaction
+			Arena* _arena;
 
 		public: // CONSTRUCTORS
 
 			Block();
 			Block(uint32_t timestamp);
 
+			// The block is owned by the arena and released with it.
+			Block(Arena* arena);
+
 			virtual ~Block();
 
 		public: // METHODS
 
 			void deserialize(be_ptr_istream& stream);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
+
+			// Keeps the root hash up to date, only the path from the new transaction to the root being rehashed.
+			// The first call on a decoded block builds the tree of the transactions it already has.
+			void addTransaction(const TransactionVariant& t);
+
+			// Recomputes the root hash from scratch, e.g. to check the one of a decoded block.
+			b256 computeRootHash() const;
+			const b256& getRootHash() const;
+
+			uint16_t getTransactionCount() const;
+			const TransactionVariant& getTransaction(uint16_t i) const;
 
-			void addTransaction(Transaction* t);
+			bool isArenaAllocated() const;
 
 		};
 	}
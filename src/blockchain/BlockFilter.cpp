@@ -0,0 +1,119 @@
+
+#include <cstring>
+#include <stdexcept>
+
+using std::runtime_error;
+
+#include "BlockFilter.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		BlockFilter::BlockFilter() {
+			_bits.assign(MIN_SIZE, 0);
+			_hashCount = HASH_COUNT;
+		}
+
+		BlockFilter::BlockFilter(size_t keyCount) {
+			_bits.assign(std::max(MIN_SIZE, (keyCount * BITS_PER_KEY + 7) / 8), 0);
+			_hashCount = HASH_COUNT;
+		}
+
+		BlockFilter::~BlockFilter() {
+		}
+
+		void BlockFilter::build(const Block& b) {
+			size_t keyCount = 0;
+			for (uint16_t i = 0; i < b.getTransactionCount(); ++i) {
+				const TransactionVariant& t = b.getTransaction(i);
+				keyCount += getTransactionOutputs(t).size() + (getTransactionInput(t) ? 1 : 0);
+			}
+
+			_bits.assign(std::max(MIN_SIZE, (keyCount * BITS_PER_KEY + 7) / 8), 0);
+			_hashCount = HASH_COUNT;
+
+			for (uint16_t i = 0; i < b.getTransactionCount(); ++i) {
+				const TransactionVariant& t = b.getTransaction(i);
+				const TransactionOutputs& outputs = getTransactionOutputs(t);
+				for (size_t k = 0; k < outputs.size(); ++k) {
+					add(outputs[k].address);
+				}
+				const TransactionInput* input = getTransactionInput(t);
+				if (input) {
+					add(input->source);
+				}
+			}
+		}
+
+		void BlockFilter::add(const b120& key) {
+			uint64_t h1;
+			uint64_t h2;
+			memcpy(&h1, key.b, sizeof(h1));
+			memcpy(&h2, key.b + sizeof(key.b) - sizeof(h2), sizeof(h2));
+			h2 |= 1;
+
+			uint64_t bitCount = (uint64_t)_bits.size() * 8;
+			for (uint8_t i = 0; i < _hashCount; ++i) {
+				uint64_t bit = (h1 + i * h2) % bitCount;
+				_bits[(size_t)(bit >> 3)] |= (byte)(1 << (bit & 7));
+			}
+		}
+
+		bool BlockFilter::mayContain(const b120& key) const {
+			if (_bits.empty()) {
+				return false;
+			}
+
+			uint64_t h1;
+			uint64_t h2;
+			memcpy(&h1, key.b, sizeof(h1));
+			memcpy(&h2, key.b + sizeof(key.b) - sizeof(h2), sizeof(h2));
+			h2 |= 1;
+
+			uint64_t bitCount = (uint64_t)_bits.size() * 8;
+			for (uint8_t i = 0; i < _hashCount; ++i) {
+				uint64_t bit = (h1 + i * h2) % bitCount;
+				if ((_bits[(size_t)(bit >> 3)] & (1 << (bit & 7))) == 0) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool BlockFilter::mayContainAny(const vector<b120>& keys) const {
+			for (size_t i = 0; i < keys.size(); ++i) {
+				if (mayContain(keys[i])) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void BlockFilter::deserialize(be_ptr_istream& stream) {
+			uint32_t size;
+			stream >> _hashCount;
+			stream >> size;
+
+			// checked before anything is allocated, a torn or corrupted record giving any size
+			if (_hashCount == 0 || size > stream.get_remaining_size()) {
+				throw runtime_error("Invalid ecrp::blockchain::BlockFilter of " + std::to_string(size) + " bytes and " + std::to_string(_hashCount) + " hashes.");
+			}
+			_bits.resize(size);
+			if (size > 0) {
+				stream.read(_bits.data(), size);
+			}
+		}
+
+		void BlockFilter::serialize(be_ptr_ostream& stream) const {
+			stream << _hashCount;
+			stream << (uint32_t)_bits.size();
+			stream.write(_bits.data(), _bits.size());
+		}
+
+		size_t BlockFilter::serializedSize() const {
+			return sizeof(_hashCount) + sizeof(uint32_t) + _bits.size();
+		}
+	}
+}
\ No newline at end of file
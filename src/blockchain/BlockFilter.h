@@ -0,0 +1,59 @@
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+#include "utils/streams.h"
+#include "crypto/Crypto.h"
+#include "Block.h"
+
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::crypto::b120;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Bloom filter over the output addresses and the input sources of a block, so that a wallet rescan can
+		// skip the blocks which surely do not concern it without decoding them. Addresses and transaction ids
+		// already are hashes, so the bit positions are derived from their bytes by double hashing.
+		// With 10 bits and 7 probes per key, about 1% of the blocks not concerned still match.
+		class BlockFilter {
+
+		private: // CONSTANTS
+
+			static const size_t BITS_PER_KEY = 10;
+			static const uint8_t HASH_COUNT = 7;
+			static const size_t MIN_SIZE = 8;
+
+		private: // MEMBERS
+
+			vector<byte> _bits;
+			uint8_t _hashCount;
+
+		public: // CONSTRUCTORS
+
+			BlockFilter();
+			BlockFilter(size_t keyCount);
+
+			virtual ~BlockFilter();
+
+		public: // METHODS
+
+			void build(const Block& b);
+
+			void add(const b120& key);
+			bool mayContain(const b120& key) const;
+			bool mayContainAny(const vector<b120>& keys) const;
+
+			void deserialize(be_ptr_istream& stream);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+
+#include "BlockFilterLog.h"
+
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		BlockFilterLog::BlockFilterLog(const string& filename) : RecordLog(filename) {
+		}
+
+		BlockFilterLog::~BlockFilterLog() {
+		}
+
+		void BlockFilterLog::append(MasterBlock& mb) {
+			vector<BlockFilter> filters(mb.getBlockCount());
+			size_t size = sizeof(uint16_t);
+			for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+				filters[i].build(*mb.getBlock(i));
+				size += filters[i].serializedSize();
+			}
+
+			vector<byte> payload(size);
+			be_ptr_ostream s(payload.data(), payload.size());
+			s << mb.getBlockCount();
+			for (size_t i = 0; i < filters.size(); ++i) {
+				filters[i].serialize(s);
+			}
+
+			appendRecord(mb.getId(), payload);
+		}
+
+		void BlockFilterLog::findBlocks(const vector<b120>& keys, vector<BlockReference>& blocks) const {
+			BlockFilter filter;
+			readRecords([&](uint32_t id, be_ptr_istream& s) {
+				uint16_t blockCount;
+				s >> blockCount;
+				for (uint16_t i = 0; i < blockCount; ++i) {
+					filter.deserialize(s);
+					if (filter.mayContainAny(keys)) {
+						BlockReference reference;
+						reference.masterBlockId = id;
+						reference.blockIndex = i;
+						blocks.push_back(reference);
+					}
+				}
+			});
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+#include "RecordLog.h"
+#include "BlockFilter.h"
+#include "MasterBlock.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		struct BlockReference {
+			uint32_t masterBlockId;
+			uint16_t blockIndex;
+		};
+
+		// Persisted Bloom filters of the blocks of every MasterBlock, one record per MasterBlock holding the
+		// filters of its blocks in order. They take a few bytes per output, so a scan maps them all at once.
+		class BlockFilterLog : public RecordLog {
+
+		public: // CONSTRUCTORS
+
+			BlockFilterLog(const string& filename);
+
+			virtual ~BlockFilterLog();
+
+		public: // METHODS
+
+			void append(MasterBlock& mb);
+
+			// Lists the blocks whose filter matches any of the keys (addresses or transaction ids), in chain order.
+			// The blocks listed may still not concern the keys, but the other ones surely do not.
+			void findBlocks(const vector<b120>& keys, vector<BlockReference>& blocks) const;
+
+		};
+	}
+}
\ No newline at end of file
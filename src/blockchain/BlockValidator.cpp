@@ -0,0 +1,267 @@
+
+#include <stdexcept>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+
+
+using std::runtime_error;
+
+#include "BlockValidator.h"
+#include "crypto/Crypto.h"
+#include "utils/utils.h"
+
+using ecrp::crypto::BalancedSignature;
+using ecrp::crypto::BalancedPublicKey;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		BlockValidator::BlockValidator() {
+			_threadCount = ecrp::getProcessorCount();
+			_verifiedCount = 0;
+		}
+
+		BlockValidator::~BlockValidator() {
+		}
+
+		void BlockValidator::setThreadCount(uint32_t threadCount) {
+			_threadCount = std::max<uint32_t>(1, threadCount);
+		}
+
+		void BlockValidator::setSignatureCacheSize(size_t maxSize) {
+			_signatures.setMaxSize(maxSize);
+		}
+
+		bool BlockValidator::verify(const BasicTransaction& t) const {
+			vector<byte> buffer;
+			b256 message = t.getSigningHash(buffer);
+			b256 key = SignatureCache::getKey(message, t.getInput());
+			if (_signatures.contains(key)) {
+				return true;
+			}
+
+			if (!verifySignature(message, t.getInput())) {
+				return false;
+			}
+			_signatures.insert(key);
+			return true;
+		}
+
+		void BlockValidator::validate(const Block& b) const {
+			vector<SignedInput> inputs;
+			collectInputs(b, 0, inputs);
+
+			size_t failedIndex;
+			if (!verifyInputs(inputs, failedIndex, NULL)) {
+				throw runtime_error("Invalid signature in transaction '" + std::to_string(inputs[failedIndex].transactionIndex) + "' of an ecrp::blockchain::Block.");
+			}
+		}
+
+		void BlockValidator::validate(MasterBlock& mb, vector<b256>* pCachedKeys) const {
+			vector<SignedInput> inputs;
+			for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+				collectInputs(*mb.getBlock(i), i, inputs);
+			}
+
+			size_t failedIndex;
+			if (!verifyInputs(inputs, failedIndex, pCachedKeys)) {
+				throw runtime_error("Invalid signature in transaction '" + std::to_string(inputs[failedIndex].transactionIndex) + "' of block '"
+					+ std::to_string(inputs[failedIndex].blockIndex) + "' of ecrp::blockchain::MasterBlock '" + std::to_string(mb.getId()) + "'.");
+			}
+		}
+
+		void BlockValidator::forgetSignatures(const vector<b256>& keys) const {
+			for (size_t i = 0; i < keys.size(); ++i) {
+				_signatures.contains(keys[i], true);
+			}
+		}
+
+		uint64_t BlockValidator::getVerifiedCount() const {
+			return _verifiedCount;
+		}
+
+		void BlockValidator::checkSpends(MasterBlock& mb, const UtxoSet& utxos, vector<b120>& ids) const {
+			vector<const TransactionVariant*> transactions;
+			for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+				const Block& b = *mb.getBlock(i);
+				for (uint16_t k = 0; k < b.getTransactionCount(); ++k) {
+					transactions.push_back(&b.getTransaction(k));
+				}
+			}
+
+			// the ids of the created outputs cost a sha256 each, so they are computed in parallel as well
+			ids.resize(transactions.size());
+			ecrp::parallelFor(transactions.size(), _threadCount, [&](size_t begin, size_t end) {
+				vector<byte> buffer;
+				for (size_t i = begin; i < end; ++i) {
+					ids[i] = getTransactionId(*transactions[i], buffer);
+				}
+			});
+
+			size_t shardCount = _threadCount;
+			vector<vector<OutputReference> > spends(shardCount);
+			vector<vector<OutputReference> > creations(shardCount);
+			auto shardOf = [shardCount](const b120& source) {
+				uint64_t h;
+				memcpy(&h, source.b, sizeof(h));
+				return (size_t)(h % shardCount);
+			};
+
+			for (uint32_t p = 0; p < transactions.size(); ++p) {
+				OutputReference r;
+				r.position = p;
+
+				const TransactionInput* input = getTransactionInput(*transactions[p]);
+				if (input) {
+					r.outPoint.source = input->source;
+					r.outPoint.outputId = input->sourceOutputId;
+					spends[shardOf(r.outPoint.source)].push_back(r);
+				}
+
+				size_t outputCount = getTransactionOutputs(*transactions[p]).size();
+				r.outPoint.source = ids[p];
+				for (uint16_t i = 0; i < outputCount; ++i) {
+					r.outPoint.outputId = i;
+					creations[shardOf(ids[p])].push_back(r);
+				}
+			}
+
+			std::atomic<bool> isFailed(false);
+			vector<string> errors(shardCount);
+			ecrp::parallelFor(shardCount, _threadCount, [&](size_t begin, size_t end) {
+				for (size_t s = begin; s < end; ++s) {
+					errors[s] = checkShard(spends[s], creations[s], utxos, isFailed);
+				}
+			});
+
+			for (size_t s = 0; s < shardCount; ++s) {
+				if (!errors[s].empty()) {
+					throw runtime_error(errors[s] + " in ecrp::blockchain::MasterBlock '" + std::to_string(mb.getId()) + "'.");
+				}
+			}
+		}
+
+		string BlockValidator::checkShard(const vector<OutputReference>& spends, const vector<OutputReference>& creations, const UtxoSet& utxos, std::atomic<bool>& isFailed) const {
+			// the UTXO set is only read here, which is safe from several threads
+			std::unordered_map<OutPoint, uint32_t, OutPointHash, OutPointEqual> created(creations.size());
+			for (size_t i = 0; i < creations.size() && !isFailed; ++i) {
+				if (!created.insert(std::make_pair(creations[i].outPoint, creations[i].position)).second) {
+					isFailed = true;
+					return "Transaction '" + std::to_string(creations[i].position) + "' is duplicated";
+				}
+			}
+
+			std::unordered_set<OutPoint, OutPointHash, OutPointEqual> spent(spends.size());
+			TransactionOutput output;
+			for (size_t i = 0; i < spends.size() && !isFailed; ++i) {
+				const OutputReference& r = spends[i];
+				string position = std::to_string(r.position);
+
+				if (!spent.insert(r.outPoint).second) {
+					isFailed = true;
+					return "Transaction '" + position + "' spends an output already spent";
+				}
+
+				auto c = created.find(r.outPoint);
+				if (c != created.end()) {
+					if (c->second >= r.position) {
+						isFailed = true;
+						return "Transaction '" + position + "' spends an output created after it";
+					}
+				} else if (!utxos.find(r.outPoint, output)) {
+					isFailed = true;
+					return "Transaction '" + position + "' spends a missing output";
+				}
+			}
+
+			return string();
+		}
+
+		void BlockValidator::collectInputs(const Block& b, uint16_t blockIndex, vector<SignedInput>& inputs) const {
+			for (uint16_t i = 0; i < b.getTransactionCount(); ++i) {
+				const BasicTransaction* t = boost::get<BasicTransaction>(&b.getTransaction(i));
+				if (t) {
+					SignedInput input;
+					input.blockIndex = blockIndex;
+					input.transactionIndex = i;
+					input.transaction = t;
+					inputs.push_back(input);
+				}
+			}
+		}
+
+		bool BlockValidator::verifyInputs(const vector<SignedInput>& inputs, size_t& failedIndex, vector<b256>* pCachedKeys) const {
+			// Workers claim small batches from a shared counter, which balances the load without
+			// contending on every signature, and give up as soon as any of them has failed.
+			std::atomic<size_t> next(0);
+			std::atomic<bool> isFailed(false);
+			std::atomic<size_t> firstFailure(inputs.size());
+
+			// each worker only writes the slots of the inputs it claimed
+			vector<b256> keys(pCachedKeys ? inputs.size() : 0);
+			vector<char> isCached(keys.size(), 0);
+
+			// an exception stops the other workers too, and parallelRun rethrows it
+			auto worker = [&](size_t) {
+				try {
+					vector<byte> buffer;
+					for (size_t begin = next.fetch_add(BATCH_SIZE); begin < inputs.size() && !isFailed; begin = next.fetch_add(BATCH_SIZE)) {
+						size_t end = std::min(begin + BATCH_SIZE, inputs.size());
+						for (size_t i = begin; i < end && !isFailed; ++i) {
+							const TransactionInput& input = inputs[i].transaction->getInput();
+							b256 message = inputs[i].transaction->getSigningHash(buffer);
+
+							b256 key = SignatureCache::getKey(message, input);
+							if (_signatures.contains(key)) {
+								if (pCachedKeys) {
+									keys[i] = key;
+									isCached[i] = 1;
+								}
+								continue;
+							}
+
+							if (!verifySignature(message, input)) {
+								size_t current = firstFailure;
+								while (i < current && !firstFailure.compare_exchange_weak(current, i)) {
+								}
+								isFailed = true;
+							}
+						}
+					}
+				} catch (...) {
+					isFailed = true;
+					throw;
+				}
+			};
+
+			ecrp::parallelRun(std::min((size_t)_threadCount, (inputs.size() + BATCH_SIZE - 1) / BATCH_SIZE), worker);
+
+			if (pCachedKeys) {
+				for (size_t i = 0; i < keys.size(); ++i) {
+					if (isCached[i]) {
+						pCachedKeys->push_back(keys[i]);
+					}
+				}
+			}
+
+			failedIndex = firstFailure;
+			return !isFailed;
+		}
+
+		bool BlockValidator::verifySignature(const b256& message, const TransactionInput& input) const {
+			++_verifiedCount;
+
+			BalancedSignature signature;
+			signature.r = input.signatureR;
+			signature.s = input.signatureS;
+			BalancedPublicKey publicKey;
+			publicKey.q = input.publicKey;
+
+			return ecrp::crypto::verifyData<b256>(&message, sizeof(message), signature, publicKey);
+		}
+	}
+}
\ No newline at end of file
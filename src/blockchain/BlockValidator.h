@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+
+using std::vector;
+using std::string;
+
+#include "Block.h"
+#include "MasterBlock.h"
+#include "UtxoSet.h"
+#include "SignatureCache.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Checks the signatures of every input of a block, or of a whole MasterBlock, as one batch
+		// spread over all cores. Workers stop as soon as one of them finds an invalid signature.
+		// Spends are checked in parallel shards partitioned by the source of the spent output.
+		// Signatures verified once for the mempool are remembered, and are not verified again when connected.
+		class BlockValidator {
+
+		private: // CONSTANTS
+
+			static const size_t BATCH_SIZE = 32;
+
+		private: // TYPES
+
+			struct SignedInput {
+				uint16_t blockIndex;
+				uint16_t transactionIndex;
+				const BasicTransaction* transaction;
+			};
+
+			// An output spent or created by the transaction at the given position of the MasterBlock.
+			struct OutputReference {
+				OutPoint outPoint;
+				uint32_t position;
+			};
+
+		private: // MEMBERS
+
+			uint32_t _threadCount;
+			mutable SignatureCache _signatures;
+			mutable std::atomic<uint64_t> _verifiedCount;
+
+		public: // CONSTRUCTORS
+
+			BlockValidator();
+
+			virtual ~BlockValidator();
+
+		public: // METHODS
+
+			void setThreadCount(uint32_t threadCount);
+			void setSignatureCacheSize(size_t maxSize);
+
+			// Verifies the signature of a transaction out of any block, as the mempool does on admission, and
+			// remembers it when valid. Thread-safe.
+			bool verify(const BasicTransaction& t) const;
+
+			// Both throw on the first invalid signature found. The signatures found in the cache are left in it, since
+			// the MasterBlock may still fail to connect, and their keys are returned for forgetSignatures().
+			void validate(const Block& b) const;
+			void validate(MasterBlock& mb, vector<b256>* pCachedKeys = NULL) const;
+
+			// Forgets the cached signatures of a connected MasterBlock, whose transactions will not be seen again.
+			void forgetSignatures(const vector<b256>& keys) const;
+
+			// Number of signatures actually verified so far, those found in the cache not counting.
+			uint64_t getVerifiedCount() const;
+
+			// Checks that every input spends an output which either is in the UTXO set or is created earlier
+			// in the MasterBlock, and that no output is spent twice. Inputs and created outputs are sharded by
+			// a hash of their source, so all the spends of an output land in the same shard, and each shard is
+			// checked by its own thread without any locking. Throws on the first invalid spend found.
+			// The ids of the transactions, in MasterBlock order, are returned for UtxoSet::applyMasterBlock.
+			void checkSpends(MasterBlock& mb, const UtxoSet& utxos, vector<b120>& transactionIds) const;
+
+		private: // METHODS
+
+			void collectInputs(const Block& b, uint16_t blockIndex, vector<SignedInput>& inputs) const;
+			bool verifyInputs(const vector<SignedInput>& inputs, size_t& failedIndex, vector<b256>* pCachedKeys) const;
+			bool verifySignature(const b256& message, const TransactionInput& input) const;
+			string checkShard(const vector<OutputReference>& spends, const vector<OutputReference>& creations, const UtxoSet& utxos, std::atomic<bool>& isFailed) const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -1,26 +1,78 @@
 
+#include <stdexcept>
+#include <iostream>
+#include <memory>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 #include "Blockchain.h"
 #include "TransactionType.h"
 #include "utils/utils.h"
 #include "utils/streams.h"
+#include "utils/compression.h"
 
+using std::runtime_error;
+using boost::interprocess::file_mapping;
+using boost::interprocess::mapped_region;
+using boost::interprocess::read_only;
 using ecrp::io::be_file_istream;
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
 
 //----------------------------------------------------------------------
 
 namespace ecrp {
 	namespace blockchain {
 
-		const char* BLOCKCHAIN_FILENAME = "blocks.dat";
+		const char* LEGACY_BLOCKCHAIN_FILENAME = "blocks.dat";
+		const char* BLOCKCHAIN_MANIFEST_FILENAME = "blocks.manifest";
+		const char* BLOCKCHAIN_INDEX_FILENAME = "blocks.idx";
+		const char* BLOCKCHAIN_DICTIONARY_FILENAME = "blocks.dict";
+		const char* HEADER_CHAIN_FILENAME = "headers.dat";
+		const char* UNDO_LOG_FILENAME = "undo.dat";
+		const char* BLOCK_FILTER_LOG_FILENAME = "filters.dat";
+		const char* UTXO_SNAPSHOT_FILENAME = "utxo.dat";
+		const uint32_t DEFAULT_SNAPSHOT_INTERVAL = 1000;
+		const size_t DICTIONARY_SAMPLE_COUNT = 1000;
+
+		Blockchain::Blockchain() : _manifest(BLOCKCHAIN_MANIFEST_FILENAME), _index(&_manifest, BLOCKCHAIN_INDEX_FILENAME), _appender(&_manifest, &_index), _headers(HEADER_CHAIN_FILENAME), _undoLog(UNDO_LOG_FILENAME), _filters(BLOCK_FILTER_LOG_FILENAME), _mempool(&_utxos) {
+			_isLazy = false;
+			_loadingThreadCount = ecrp::getProcessorCount();
+			_loadedSize = 0;
+			_loadingTime = 0;
+			_snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL;
+			_unsnapshottedCount = 0;
+			_hasSnapshot = false;
+			_snapshotId = 0;
+			_isCompressing = false;
+			_isIndexOpen = false;
 
-		Blockchain::Blockchain() {
+			_mempool.setValidator(&_validator);
 		}
 
 		Blockchain::~Blockchain() {
+			try {
+				_appender.close();
+			} catch (const std::exception& e) {
+				std::cerr << "Closing the chain failed: " << e.what() << std::endl;
+			}
+
+			for (auto i = _data.begin(); i != _data.end(); ++i) {
+				delete *i;
+			}
+			_data.clear();
 		}
 
 		void Blockchain::init() {
+			openIndex();
+			_appender.open();
+			_headers.open();
+			_undoLog.open();
+			_filters.open();
 			load();
 
 			if (_data.size() == 0) {
@@ -28,35 +80,601 @@ namespace ecrp {
 			}
 		}
 
+		void Blockchain::setLazyDecoding(bool isLazy) {
+			_isLazy = isLazy;
+		}
+
+		void Blockchain::setLoadingThreadCount(uint32_t threadCount) {
+			_loadingThreadCount = std::max<uint32_t>(1, threadCount);
+		}
+
+		void Blockchain::setSyncPolicy(SyncPolicy policy, uint64_t threshold) {
+			try {
+				_appender.setSyncPolicy(policy, threshold);
+			} catch (...) {
+				rollBackUncommitted(NULL);
+				throw;
+			}
+		}
+
+		void Blockchain::setSegmentSize(uint64_t segmentSize) {
+			_appender.setSegmentSize(segmentSize);
+		}
+
+		void Blockchain::setCompression(bool isCompressing) {
+			_isCompressing = isCompressing;
+			_appender.setCompression(_isCompressing, _dictionary);
+		}
+
+		void Blockchain::trainDictionary() {
+			if (boost::filesystem::exists(BLOCKCHAIN_DICTIONARY_FILENAME)) {
+				throw runtime_error("The chain dictionary '" + string(BLOCKCHAIN_DICTIONARY_FILENAME) + "' is already trained.");
+			}
+
+			// Samples are spread over the whole chain so that the dictionary does not only fit its first MasterBlocks,
+			// and each of them is cut to its share of MAX_DICTIONARY_SAMPLE_SIZE, which trainDictionary() looks at.
+			vector<vector<byte> > samples;
+			size_t step = std::max<size_t>(1, _data.size() / DICTIONARY_SAMPLE_COUNT);
+			size_t sampleLimit = ecrp::MAX_DICTIONARY_SAMPLE_SIZE / std::max<size_t>(1, (_data.size() + step - 1) / step);
+			size_t k = 0;
+			for (auto i = _data.begin(); i != _data.end(); ++i, ++k) {
+				if (k % step == 0) {
+					vector<byte> sample((*i)->serializedSize());
+					be_ptr_ostream s(sample.data(), sample.size());
+					(*i)->serialize(s);
+					if (sample.size() > sampleLimit) {
+						sample.resize(sampleLimit);
+					}
+					samples.push_back(std::move(sample));
+				}
+			}
+
+			vector<byte> dictionary = ecrp::trainDictionary(samples);
+			if (dictionary.empty()) {
+				return;
+			}
+
+			string tempFilename = string(BLOCKCHAIN_DICTIONARY_FILENAME) + ".tmp";
+			std::FILE* file = std::fopen(tempFilename.c_str(), "wb");
+			if (file == NULL) {
+				throw runtime_error("Unable to create the chain dictionary '" + tempFilename + "'.");
+			}
+			bool isWritten = std::fwrite(dictionary.data(), dictionary.size(), 1, file) == 1 && ecrp::syncFile(file);
+			std::fclose(file);
+			if (!isWritten) {
+				boost::filesystem::remove(tempFilename);
+				throw runtime_error("Writing the chain dictionary '" + tempFilename + "' failed.");
+			}
+			boost::filesystem::rename(tempFilename, BLOCKCHAIN_DICTIONARY_FILENAME);
+
+			_dictionary = dictionary;
+			_appender.setCompression(_isCompressing, _dictionary);
+		}
+
+		void Blockchain::setSnapshotInterval(uint32_t interval) {
+			_snapshotInterval = interval;
+		}
+
+		void Blockchain::setSignatureCacheSize(size_t maxSize) {
+			_validator.setSignatureCacheSize(maxSize);
+		}
+
+		double Blockchain::getLoadingThroughput() const {
+			if (_loadingTime == 0) {
+				return 0.0;
+			}
+			return (double)_loadedSize / (1000.0 * _loadingTime); // MB/s, the loading time being in ms
+		}
+
+		void Blockchain::migrate() {
+			// Chains written before segments were introduced live in a single file, which becomes the first
+			// segment as is since both hold the same records. The old index has another entry format.
+			if (boost::filesystem::exists(LEGACY_BLOCKCHAIN_FILENAME) && !boost::filesystem::exists(BLOCKCHAIN_MANIFEST_FILENAME)
+				&& !boost::filesystem::exists(SegmentManifest::getSegmentFilename(0))) {
+				boost::filesystem::rename(LEGACY_BLOCKCHAIN_FILENAME, SegmentManifest::getSegmentFilename(0));
+				boost::filesystem::remove(BLOCKCHAIN_INDEX_FILENAME);
+			}
+		}
+
+		void Blockchain::loadDictionary() {
+			if (!boost::filesystem::exists(BLOCKCHAIN_DICTIONARY_FILENAME)) {
+				return;
+			}
+
+			be_file_istream fs(BLOCKCHAIN_DICTIONARY_FILENAME);
+			if (!fs.is_open()) {
+				throw runtime_error("Unable to open the chain dictionary '" + string(BLOCKCHAIN_DICTIONARY_FILENAME) + "'.");
+			}
+			_dictionary.resize((size_t)fs._file_length());
+			if (!_dictionary.empty()) {
+				fs.read(_dictionary);
+			}
+			_appender.setCompression(_isCompressing, _dictionary);
+		}
+
+		void Blockchain::openIndex() {
+			// the manifest is only read once, since loading it again would drop the records the index gave it
+			if (!_isIndexOpen) {
+				migrate();
+				loadDictionary();
+				_manifest.load();
+				_isIndexOpen = true;
+			}
+			_index.init();
+		}
+
 		void Blockchain::load() {
-			be_file_istream fs;
-			fs.open(BLOCKCHAIN_FILENAME);
-			if (fs.is_open()) {
-				while (!fs.eof()) {
-					uint32_t length;
-					fs.read(length);
-
-					byte* buffer = (byte*)malloc(sizeof(byte) * length);
-					fs.read(buffer, length);
-
-					MasterBlock* mb = new MasterBlock();
-					be_ptr_istream s(buffer, length);
-					mb->deserialize(s);
-					_data.push_back(mb);
+			uint64_t t0 = ecrp::getTimestampUTC();
+
+			// Every segment is mapped once and every MasterBlock is deserialized straight from the mappings,
+			// so loading is bounded by the page cache and never copies a record into a heap buffer.
+			// The mappings are kept for the lifetime of the chain since lazy MasterBlocks decode their blocks from them.
+			vector<SegmentInfo> segments = _manifest.getSegments();
+			map<uint32_t, const byte*> bases;
+			vector<size_t> sizes(segments.size(), 0);
+			_loadedSize = 0;
+
+			for (size_t i = 0; i < segments.size(); ++i) {
+				string filename = SegmentManifest::getSegmentFilename(segments[i].number);
+				if (!boost::filesystem::exists(filename) || boost::filesystem::file_size(filename) == 0) {
+					continue;
+				}
+
+				file_mapping file(filename.c_str(), read_only);
+				mapped_region region(file, read_only);
+				_regions[segments[i].number].swap(region);
+
+				bases[segments[i].number] = (const byte*)_regions[segments[i].number].get_address();
+				sizes[i] = _regions[segments[i].number].get_size();
+				_loadedSize += sizes[i];
+			}
+
+			// segments are independent, so they are scanned in parallel and their records concatenated in chain order
+			vector<vector<MasterBlockLocation> > segmentRecords(segments.size());
+			ecrp::parallelFor(segments.size(), _loadingThreadCount, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					if (sizes[i] > 0) {
+						scanRecords(segments[i].number, bases.at(segments[i].number), sizes[i], segmentRecords[i]);
+					}
+				}
+			});
+
+			vector<MasterBlockLocation> records;
+			for (size_t i = 0; i < segmentRecords.size(); ++i) {
+				records.insert(records.end(), segmentRecords[i].begin(), segmentRecords[i].end());
+			}
+
+			// The UTXO set starts from the last snapshot and only the MasterBlocks after it are replayed, so the ones
+			// it covers are decoded lazily whatever the setting: loading only needs their headers.
+			size_t first = findSnapshotRecord(bases, records);
+
+			vector<MasterBlock*> masterBlocks;
+			deserializeRecords(bases, records, first, masterBlocks);
+			_data.insert(_data.end(), masterBlocks.begin(), masterBlocks.end());
+			syncHeaders(masterBlocks);
+
+			// as for the headers, the undo records and the block filters of the MasterBlocks lost in a crash are dropped
+			if (masterBlocks.empty()) {
+				_undoLog.clear();
+				_filters.clear();
+			} else {
+				_undoLog.truncateAfter(masterBlocks.back()->getId());
+				_filters.truncateAfter(masterBlocks.back()->getId());
+			}
+
+			uint32_t lastFilterId;
+			bool hasFilters = _filters.getLastId(lastFilterId);
+			for (size_t i = 0; i < masterBlocks.size(); ++i) {
+				if (!hasFilters || masterBlocks[i]->getId() > lastFilterId) {
+					_filters.append(*masterBlocks[i]);
+				}
+			}
+
+			UtxoUndo undo;
+			for (size_t i = first; i < masterBlocks.size(); ++i) {
+				connectMasterBlock(*masterBlocks[i], undo);
+
+				uint32_t lastId;
+				if (!_undoLog.getLastId(lastId) || masterBlocks[i]->getId() > lastId) {
+					_undoLog.append(masterBlocks[i]->getId(), undo);
+				}
+			}
+
+			_unsnapshottedCount = (uint32_t)(masterBlocks.size() - first);
+			if (_snapshotInterval > 0 && _unsnapshottedCount >= _snapshotInterval) {
+				saveSnapshot(masterBlocks.back()->getId());
+			}
+
+			_loadingTime = ecrp::getTimestampUTC() - t0;
+		}
+
+		size_t Blockchain::findSnapshotRecord(const map<uint32_t, const byte*>& segments, const vector<MasterBlockLocation>& records) {
+			uint32_t snapshotId;
+			if (!_utxos.load(UTXO_SNAPSHOT_FILENAME, snapshotId)) {
+				return 0;
+			}
+
+			// Every record starts with its MasterBlock id, in clear even when compressed. A snapshot whose
+			// MasterBlock is not in the chain (e.g. lost in a crash) is discarded.
+			for (size_t i = records.size(); i > 0; --i) {
+				be_ptr_istream s(segments.at(records[i - 1].segment) + records[i - 1].offset, records[i - 1].length);
+				uint32_t id;
+				s >> id;
+				if (id == snapshotId) {
+					_hasSnapshot = true;
+					_snapshotId = snapshotId;
+					return i;
+				}
+			}
+
+			// without the MasterBlocks of the pruned segments the set cannot be rebuilt from scratch
+			if (_manifest.getSegmentCount() > 0 && _manifest.getSegment(0).number > 0) {
+				throw runtime_error("The UTXO snapshot does not match the pruned chain.");
+			}
+			_utxos.clear();
+			return 0;
+		}
+
+		void Blockchain::syncHeaders(const vector<MasterBlock*>& masterBlocks) {
+			// Headers are written without waiting for their MasterBlock to be durable, so the ones past the
+			// last loaded MasterBlock were lost in a crash, and so is anything after ids stop growing.
+			// The missing ones are then taken from the segments.
+			size_t count = 0;
+			for (size_t n = _headers.size(); count < n && !masterBlocks.empty(); ++count) {
+				uint32_t id = _headers.getId(count);
+				if (id > masterBlocks.back()->getId() || (count > 0 && id <= _headers.getId(count - 1))) {
+					break;
+				}
+			}
+			_headers.truncate(count);
+
+			for (size_t i = 0; i < masterBlocks.size(); ++i) {
+				if (count == 0 || masterBlocks[i]->getId() > _headers.getId(count - 1)) {
+					_headers.append(*masterBlocks[i]);
+				}
+			}
+		}
+
+		void Blockchain::scanRecords(uint32_t segment, const byte* data, size_t size, vector<MasterBlockLocation>& records) {
+			size_t offset = 0;
+
+			while (offset < size) {
+				uint32_t length;
+				be_ptr_istream header(data + offset, size - offset);
+				header >> length;
+				offset += sizeof(length);
+
+				bool isCompressed = (length & COMPRESSED_RECORD_FLAG) != 0;
+				length &= ~COMPRESSED_RECORD_FLAG;
+
+				if (length > size - offset) {
+					throw runtime_error("Truncated ecrp::blockchain::MasterBlock record at offset '" + std::to_string(offset - sizeof(length))
+						+ "' of segment '" + SegmentManifest::getSegmentFilename(segment) + "'.");
+				}
+
+				MasterBlockLocation location;
+				location.segment = segment;
+				location.offset = offset;
+				location.length = length;
+				location.isCompressed = isCompressed;
+				records.push_back(location);
+
+				offset += length;
+			}
+		}
+
+		void Blockchain::deserializeRecords(const map<uint32_t, const byte*>& segments, const vector<MasterBlockLocation>& records, size_t lazyCount, vector<MasterBlock*>& output) {
+			output.assign(records.size(), NULL);
+
+			// Records are independent, so each slice decodes its own, and each result is stored
+			// at the record's own position, which keeps the chain order intact.
+			try {
+				ecrp::parallelFor(records.size(), _loadingThreadCount, [&](size_t begin, size_t end) {
+					// Lazy MasterBlocks decode their blocks from the mapping later on, except for the compressed ones,
+					// which keep their inflated record. An eagerly decoded record is inflated into a buffer of the slice.
+					vector<byte> buffer;
+					for (size_t i = begin; i < end; ++i) {
+						MasterBlock* mb = new MasterBlock();
+						output[i] = mb;
+						bool isLazy = _isLazy || i < lazyCount;
+						const byte* data = segments.at(records[i].segment) + records[i].offset;
+						if (records[i].isCompressed && isLazy) {
+							vector<byte> raw;
+							decompressRecord(data, records[i], raw);
+							mb->deserialize(std::move(raw), true);
+						} else if (records[i].isCompressed) {
+							decompressRecord(data, records[i], buffer);
+							be_ptr_istream s(buffer.data(), buffer.size());
+							mb->deserialize(s);
+						} else {
+							be_ptr_istream s(data, records[i].length);
+							mb->deserialize(s, isLazy);
+						}
+					}
+				});
+			} catch (...) {
+				for (size_t i = 0; i < output.size(); ++i) {
+					delete output[i];
 				}
-				fs.close();
+				output.clear();
+				throw;
+			}
+		}
+
+		MasterBlock* Blockchain::getMasterBlock(uint32_t id) {
+			openIndex();
+
+			MasterBlockLocation location;
+			if (!_index.find(id, location)) {
+				return NULL;
+			}
+
+			string filename = SegmentManifest::getSegmentFilename(location.segment);
+			be_file_istream fs(filename.c_str());
+			if (!fs.is_open()) {
+				throw runtime_error("Unable to open the chain segment '" + filename + "'.");
+			}
+
+			vector<byte> buffer(location.length);
+			fs.seekg((int64_t)location.offset);
+			fs.read(buffer);
+
+			if (location.isCompressed) {
+				vector<byte> raw;
+				decompressRecord(buffer.data(), location, raw);
+				buffer.swap(raw);
+			}
+
+			std::unique_ptr<MasterBlock> mb(new MasterBlock());
+			be_ptr_istream s(buffer);
+			mb->deserialize(s);
+			return mb.release();
+		}
+
+		void Blockchain::decompressRecord(const byte* data, const MasterBlockLocation& location, vector<byte>& output) const {
+			uint32_t id;
+			uint32_t length;
+			size_t headerSize = sizeof(id) + sizeof(length);
+			if (location.length < headerSize) {
+				throw runtime_error("Truncated compressed ecrp::blockchain::MasterBlock record.");
+			}
+
+			be_ptr_istream header(data, location.length);
+			header >> id;
+			header >> length;
+
+			// the length comes from the chain files, so it is checked before anything is allocated for it
+			if (length > (location.length - headerSize) * ecrp::MAX_COMPRESSION_RATIO) {
+				throw runtime_error("Corrupted compressed ecrp::blockchain::MasterBlock record.");
+			}
+
+			output.resize(length);
+			ecrp::decompress(data + headerSize, location.length - headerSize, _dictionary, output.data(), output.size());
+		}
+
+		void Blockchain::addMasterBlock(MasterBlock* mb) {
+			// a MasterBlock with a bad signature or spending unknown outputs is rejected before anything is written
+			UtxoUndo undo;
+			vector<b256> cachedKeys;
+			connectMasterBlock(*mb, undo, &cachedKeys);
+			uint64_t sequence;
+			try {
+				_undoLog.append(mb->getId(), undo);
+				sequence = _appender.append(mb);
+			} catch (...) {
+				_undoLog.removeLast(mb->getId());
+				_utxos.revert(undo);
+				rollBackUncommitted(NULL);
+				throw;
+			}
+			_data.push_back(mb);
+			_headers.append(*mb);
+			_filters.append(*mb);
+			_mempool.removeForMasterBlock(*mb);
+
+			// the cached signatures are only given back once the MasterBlock is in, a rejected one being likely to come again
+			_validator.forgetSignatures(cachedKeys);
+
+			// the undo of a MasterBlock is kept until its record is known to be durable
+			uint64_t committedCount = _appender.getCommittedCount();
+			while (!_uncommitted.empty() && _uncommitted.front().sequence < committedCount) {
+				_uncommitted.pop_front();
+			}
+			if (sequence >= committedCount) {
+				UncommittedMasterBlock uncommitted;
+				uncommitted.sequence = sequence;
+				uncommitted.undo = std::move(undo);
+				_uncommitted.push_back(std::move(uncommitted));
 			}
+
+			if (_snapshotInterval > 0 && ++_unsnapshottedCount >= _snapshotInterval) {
+				saveSnapshot(mb->getId(), mb);
+			}
+		}
+
+		MasterBlock* Blockchain::disconnectTip() {
+			// the pending records are committed first, so that the tip is the last record of the chain segments
+			commit();
+			_uncommitted.clear();
+
+			if (_data.empty()) {
+				throw runtime_error("There is no MasterBlock to disconnect.");
+			}
+
+			MasterBlock* mb = _data.back();
+			uint32_t id = mb->getId();
+			uint32_t previousId = _data.size() > 1 ? (*std::prev(_data.end(), 2))->getId() : 0;
+
+			UtxoUndo undo;
+			MasterBlockLocation location;
+			if (!_undoLog.read(id, undo)) {
+				throw runtime_error("No undo record for the MasterBlock '" + std::to_string(id) + "'.");
+			}
+			if (!_index.find(id, location)) {
+				throw runtime_error("The MasterBlock '" + std::to_string(id) + "' is not indexed.");
+			}
+			if (!_appender.canRemoveLast(location)) {
+				throw runtime_error("The MasterBlock '" + std::to_string(id) + "' is not the last record of the chain segments.");
+			}
+
+			// A lazy MasterBlock decodes its blocks from the mapping of its segment, which is about to be cut off.
+			for (uint16_t i = 0; i < mb->getBlockCount(); ++i) {
+				mb->getBlock(i);
+			}
+
+			// nothing is changed before this point, so a failed check leaves the chain as it was
+			_utxos.revert(undo);
+			_mempool.restoreForMasterBlock(*mb, undo);
+
+			// a snapshot covering the MasterBlock would be ahead of the chain, so one of the new tip replaces it
+			if (_hasSnapshot && _snapshotId >= id) {
+				if (_data.size() > 1) {
+					saveSnapshot(previousId);
+				} else {
+					boost::filesystem::remove(UTXO_SNAPSHOT_FILENAME);
+					_hasSnapshot = false;
+				}
+			} else if (_unsnapshottedCount > 0) {
+				--_unsnapshottedCount;
+			}
+
+			// once the record is cut off the segment, the other files are reconciled on load anyway
+			_appender.removeLast(location);
+			_index.removeLast(id, previousId);
+			if (_headers.size() > 0 && _headers.getId(_headers.size() - 1) == id) {
+				_headers.truncate(_headers.size() - 1);
+			}
+			_undoLog.removeLast(id);
+			_filters.removeLast(id);
+
+			_data.pop_back();
+			return mb;
+		}
+
+		void Blockchain::connectMasterBlock(MasterBlock& mb, UtxoUndo& undo, vector<b256>* pCachedKeys) {
+			// MasterBlocks covered by a UTXO snapshot were checked when first connected and are never checked again
+			_validator.validate(mb, pCachedKeys);
+			vector<b120> transactionIds;
+			_validator.checkSpends(mb, _utxos, transactionIds);
+			_utxos.applyMasterBlock(mb, transactionIds, undo);
+		}
+
+		void Blockchain::saveSnapshot(uint32_t masterBlockId, const MasterBlock* pKept) {
+			// the snapshot must never get ahead of what is durably in the chain file
+			commit(pKept);
+			_undoLog.sync();
+			_utxos.save(UTXO_SNAPSHOT_FILENAME, masterBlockId);
+			_unsnapshottedCount = 0;
+			_hasSnapshot = true;
+			_snapshotId = masterBlockId;
+		}
+
+		void Blockchain::commit(const MasterBlock* pKept) {
+			try {
+				_appender.commit();
+			} catch (...) {
+				rollBackUncommitted(pKept);
+				throw;
+			}
+		}
+
+		void Blockchain::rollBackUncommitted(const MasterBlock* pKept) {
+			// Nothing is lost unless a commit failed, whichever thread ran it. The appender then dropped every record
+			// past the last durable one, and their MasterBlocks are the last ones of the chain, so they are rolled
+			// back latest first, as disconnectTip() does.
+			if (!_appender.hasFailed()) {
+				return;
+			}
+
+			uint64_t committedCount = _appender.getCommittedCount();
+			while (!_uncommitted.empty() && _uncommitted.back().sequence >= committedCount) {
+				MasterBlock* mb = _data.back();
+				uint32_t id = mb->getId();
+				const UtxoUndo& undo = _uncommitted.back().undo;
+
+				_utxos.revert(undo);
+				_mempool.restoreForMasterBlock(*mb, undo);
+				if (_headers.size() > 0 && _headers.getId(_headers.size() - 1) == id) {
+					_headers.truncate(_headers.size() - 1);
+				}
+				_undoLog.removeLast(id);
+				_filters.removeLast(id);
+				if (_unsnapshottedCount > 0) {
+					--_unsnapshottedCount;
+				}
+
+				_uncommitted.pop_back();
+				_data.pop_back();
+				if (mb != pKept) {
+					delete mb;
+				}
+			}
+		}
+
+		size_t Blockchain::pruneSegments() {
+			// The segment holding the snapshot MasterBlock is kept, so that a restart always finds it.
+			MasterBlockLocation location;
+			if (!_hasSnapshot || !_index.find(_snapshotId, location)) {
+				return 0;
+			}
+
+			size_t count = 0;
+			for (size_t i = 0; i < _manifest.getSegmentCount() && _manifest.getSegment(i).number < location.segment; ++i) {
+				++count;
+			}
+			if (count == 0) {
+				return 0;
+			}
+
+			while (!_data.empty()) {
+				MasterBlockLocation l;
+				if (!_index.find(_data.front()->getId(), l) || l.segment >= location.segment) {
+					break;
+				}
+				delete _data.front();
+				_data.pop_front();
+			}
+
+			if (!_data.empty()) {
+				_undoLog.removeBefore(_data.front()->getId());
+				_filters.removeBefore(_data.front()->getId());
+			}
+
+			_regions.erase(_regions.begin(), _regions.lower_bound(location.segment));
+			_index.removeSegmentsBefore(location.segment);
+			_manifest.pruneBefore(location.segment);
+			return count;
+		}
+
+		void Blockchain::findBlocks(const vector<b120>& keys, vector<BlockReference>& blocks) const {
+			_filters.findBlocks(keys, blocks);
+		}
+
+		const HeaderChain& Blockchain::getHeaderChain() const {
+			return _headers;
+		}
+
+		const UtxoSet& Blockchain::getUtxoSet() const {
+			return _utxos;
+		}
+
+		Mempool& Blockchain::getMempool() {
+			return _mempool;
+		}
+
+		uint64_t Blockchain::getBalanceForAddress(const b120& address) const {
+			return _utxos.getBalance(address);
 		}
 
 		void Blockchain::createGenesisBlock() {
 			/*uint32_t timestamp = ecrp::getUnixTimestampUTC();
 			MasterBlock* mb = new MasterBlock(0, timestamp);
 			Block* b = new Block(timestamp);
-			Transaction* t = new Transaction(TransactionType::REWARD);
-			TransactionOutput* o = new TransactionOutput();
-			o->amount = 12;
-			o->address = b128(); // TODO: replace with the real address
-			t->addOutput(o);
+			RewardTransaction t;
+			TransactionOutput o;
+			o.amount = 12;
+			o.address = b120(); // TODO: replace with the real address
+			t.addOutput(o);
 			b->addTransaction(t);
 			mb->addBlock(b);
 			_data.push_back(mb);*/
@@ -2,10 +2,24 @@
 #pragma once
 
 #include <list>
+#include <map>
+
+#include <boost/interprocess/mapped_region.hpp>
 
 using std::list;
+using std::map;
+using boost::interprocess::mapped_region;
 
 #include "MasterBlock.h"
+#include "SegmentManifest.h"
+#include "MasterBlockIndex.h"
+#include "MasterBlockAppender.h"
+#include "HeaderChain.h"
+#include "UndoLog.h"
+#include "BlockFilterLog.h"
+#include "UtxoSet.h"
+#include "BlockValidator.h"
+#include "Mempool.h"
 
 //----------------------------------------------------------------------
 
@@ -14,10 +28,39 @@ namespace ecrp {
 
 		class Blockchain {
 
+		private: // TYPES
+
+			// A MasterBlock whose record is not durable yet, with what is needed to roll it back if its commit fails.
+			struct UncommittedMasterBlock {
+				uint64_t sequence;
+				UtxoUndo undo;
+			};
+
 		private: // MEMBERS
 
 			list<MasterBlock*> _data;
-			list<Transaction*> _pendingTransactions;
+			list<UncommittedMasterBlock> _uncommitted;
+			SegmentManifest _manifest;
+			MasterBlockIndex _index;
+			MasterBlockAppender _appender;
+			HeaderChain _headers;
+			UndoLog _undoLog;
+			BlockFilterLog _filters;
+			UtxoSet _utxos;
+			BlockValidator _validator;
+			Mempool _mempool;
+			uint32_t _snapshotInterval;
+			uint32_t _unsnapshottedCount;
+			bool _hasSnapshot;
+			uint32_t _snapshotId;
+			map<uint32_t, mapped_region> _regions;
+			bool _isCompressing;
+			vector<byte> _dictionary;
+			bool _isIndexOpen;
+			bool _isLazy;
+			uint32_t _loadingThreadCount;
+			uint64_t _loadedSize;
+			uint64_t _loadingTime;
 
 		public: // CONSTRUCTORS
 
@@ -28,11 +71,70 @@ namespace ecrp {
 		public: // METHODS
 
 			void init();
+			void setLazyDecoding(bool isLazy);
+			void setLoadingThreadCount(uint32_t threadCount);
+			void setSyncPolicy(SyncPolicy policy, uint64_t threshold = 0);
+			void setSegmentSize(uint64_t segmentSize);
+
+			// New records are compressed with the preset dictionary, if any, and existing records are left as they are.
+			void setCompression(bool isCompressing);
+
+			// Trains the preset dictionary from a sample of the loaded MasterBlocks. The dictionary can only be trained
+			// once, since the records compressed with it cannot be read without it.
+			void trainDictionary();
+
+			// Number of MasterBlocks added between two UTXO snapshots, 0 disabling them.
+			void setSnapshotInterval(uint32_t interval);
+
+			// Number of signatures verified for the mempool remembered until their transactions are connected.
+			void setSignatureCacheSize(size_t maxSize);
+
+			double getLoadingThroughput() const;
+
+			// Reads the record from its segment, without init() being needed first.
+			MasterBlock* getMasterBlock(uint32_t id);
+
+			// Unless the sync policy is SYNC_EVERY_BLOCK, the record is committed later along with other ones. When a
+			// commit fails, here or on the flusher thread, every MasterBlock whose record was lost is rolled back from
+			// the UTXO set, the mempool and the chain files, and deleted, before the error is thrown. The MasterBlock
+			// given is left to the caller whenever this throws.
+			void addMasterBlock(MasterBlock* mb);
+
+			// Rolls the last MasterBlock back from the UTXO set, the mempool and the chain files using its undo record,
+			// and returns it (to be deleted by the caller).
+			MasterBlock* disconnectTip();
+
+			// Deletes the segments holding only MasterBlocks covered by the last UTXO snapshot, and returns their count.
+			size_t pruneSegments();
+
+			// Lists the blocks which may hold outputs paying any of the addresses or inputs spending outputs of any
+			// of the transactions, without decoding the others. See BlockFilterLog::findBlocks().
+			void findBlocks(const vector<b120>& keys, vector<BlockReference>& blocks) const;
+
+			const HeaderChain& getHeaderChain() const;
+			const UtxoSet& getUtxoSet() const;
+			Mempool& getMempool();
+			uint64_t getBalanceForAddress(const b120& address) const;
 
 		private: // MEMBERS
 
+			void migrate();
+			void loadDictionary();
+
+			// Reads the dictionary, the manifest and the index, which is all a lookup needs, so that getMasterBlock()
+			// also works on a chain which init() did not load.
+			void openIndex();
 			void load();
+			void syncHeaders(const vector<MasterBlock*>& masterBlocks);
+			void scanRecords(uint32_t segment, const byte* data, size_t size, vector<MasterBlockLocation>& records);
+			size_t findSnapshotRecord(const map<uint32_t, const byte*>& segments, const vector<MasterBlockLocation>& records);
+			void deserializeRecords(const map<uint32_t, const byte*>& segments, const vector<MasterBlockLocation>& records, size_t lazyCount, vector<MasterBlock*>& output);
+			void decompressRecord(const byte* data, const MasterBlockLocation& location, vector<byte>& output) const;
 			void createGenesisBlock();
+			void saveSnapshot(uint32_t masterBlockId, const MasterBlock* pKept = NULL);
+			void connectMasterBlock(MasterBlock& mb, UtxoUndo& undo, vector<b256>* pCachedKeys = NULL);
+			void commit(const MasterBlock* pKept = NULL);
+			void rollBackUncommitted(const MasterBlock* pKept);
 
 		};
 	}
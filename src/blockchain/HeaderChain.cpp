@@ -0,0 +1,228 @@
+
+#include <stdexcept>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+
+#include "HeaderChain.h"
+#include "Miner.h"
+#include "utils/streams.h"
+
+using std::runtime_error;
+using boost::interprocess::file_mapping;
+using boost::interprocess::read_only;
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// offsets of the fields read by the binary searches, as laid out by MasterBlock::serializeHeader()
+		const size_t ID_OFFSET = 0;
+		const size_t TIMESTAMP_OFFSET = sizeof(uint32_t) + sizeof(uint16_t);
+
+		HeaderChain::HeaderChain(const string& filename) {
+			_filename = filename;
+			_file = NULL;
+			_count = 0;
+			_mappedCount = 0;
+		}
+
+		HeaderChain::~HeaderChain() {
+			close();
+		}
+
+		void HeaderChain::open() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (_file) {
+				return;
+			}
+
+			uint64_t size = boost::filesystem::exists(_filename) ? boost::filesystem::file_size(_filename) : 0;
+			if (size % ENTRY_SIZE != 0) {
+				size -= size % ENTRY_SIZE;
+				boost::filesystem::resize_file(_filename, size);
+			}
+
+			_file = std::fopen(_filename.c_str(), "ab");
+			if (_file == NULL) {
+				throw runtime_error("Unable to open the header chain '" + _filename + "'.");
+			}
+
+			_count = (size_t)(size / ENTRY_SIZE);
+			remap();
+		}
+
+		void HeaderChain::close() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (!_file) {
+				return;
+			}
+
+			mapped_region().swap(_region);
+			_mappedCount = 0;
+
+			std::fclose(_file);
+			_file = NULL;
+		}
+
+		void HeaderChain::append(const MasterBlock& mb) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (!_file) {
+				throw runtime_error("The header chain '" + _filename + "' is not open.");
+			}
+
+			byte entry[ENTRY_SIZE];
+			be_ptr_ostream s(entry, sizeof(entry));
+			mb.serializeHeader(s);
+
+			if (std::fwrite(entry, sizeof(entry), 1, _file) != 1 || std::fflush(_file) != 0) {
+				throw runtime_error("Writing to the header chain '" + _filename + "' failed.");
+			}
+			++_count;
+		}
+
+		void HeaderChain::truncate(size_t count) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (!_file || count >= _count) {
+				return;
+			}
+
+			// the mapping must not outlive the part of the file it covers
+			mapped_region().swap(_region);
+			_mappedCount = 0;
+
+			std::fflush(_file);
+			boost::filesystem::resize_file(_filename, (uint64_t)count * ENTRY_SIZE);
+			_count = count;
+			remap();
+		}
+
+		size_t HeaderChain::size() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _count;
+		}
+
+		bool HeaderChain::getHeader(size_t i, MasterBlockHeader& header) const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (i >= _count) {
+				return false;
+			}
+
+			const byte* entry = getEntry(i);
+			be_ptr_istream s(entry, ENTRY_SIZE);
+			s >> header.id;
+			s >> header.version;
+			s >> header.timestamp;
+			s >> header.target;
+			s >> header.previousHash;
+			s >> header.masterHash;
+			s >> header.nonce;
+			header.hash = ecrp::crypto::sha256(entry, ENTRY_SIZE);
+			return true;
+		}
+
+		uint32_t HeaderChain::getId(size_t i) const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			uint32_t id;
+			be_ptr_istream s(getEntry(i) + ID_OFFSET, sizeof(id));
+			s >> id;
+			return id;
+		}
+
+		uint32_t HeaderChain::getTimestamp(size_t i) const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			uint32_t timestamp;
+			be_ptr_istream s(getEntry(i) + TIMESTAMP_OFFSET, sizeof(timestamp));
+			s >> timestamp;
+			return timestamp;
+		}
+
+		bool HeaderChain::findById(uint32_t id, MasterBlockHeader& header) const {
+			size_t first = 0;
+			size_t last = size();
+			while (first < last) {
+				size_t middle = first + (last - first) / 2;
+				if (getId(middle) < id) {
+					first = middle + 1;
+				} else {
+					last = middle;
+				}
+			}
+
+			return first < size() && getId(first) == id && getHeader(first, header);
+		}
+
+		size_t HeaderChain::findByTimestamp(uint32_t timestamp) const {
+			size_t first = 0;
+			size_t last = size();
+			while (first < last) {
+				size_t middle = first + (last - first) / 2;
+				if (getTimestamp(middle) < timestamp) {
+					first = middle + 1;
+				} else {
+					last = middle;
+				}
+			}
+			return first;
+		}
+
+		size_t HeaderChain::validate(size_t from) const {
+			size_t count = size();
+			if (from == 0) {
+				from = 1; // nothing comes before the genesis MasterBlock
+			}
+
+			MasterBlockHeader previous;
+			MasterBlockHeader header;
+			if (from > count || !getHeader(from - 1, previous)) {
+				return count;
+			}
+
+			for (size_t i = from; i < count; ++i) {
+				getHeader(i, header);
+				if (memcmp(header.previousHash.b, previous.hash.b, sizeof(previous.hash.b)) != 0 || !Miner::checkProofOfWork(header.hash, header.target)) {
+					return i;
+				}
+				previous = header;
+			}
+			return count;
+		}
+
+		const byte* HeaderChain::getEntry(size_t i) const {
+			if (i >= _count) {
+				throw runtime_error("No header at position '" + std::to_string(i) + "' in the header chain '" + _filename + "'.");
+			}
+
+			// the mapping only covers the headers there were when it was made
+			if (i >= _mappedCount) {
+				remap();
+			}
+			return (const byte*)_region.get_address() + i * ENTRY_SIZE;
+		}
+
+		void HeaderChain::remap() const {
+			mapped_region().swap(_region);
+			_mappedCount = 0;
+
+			if (_count == 0) {
+				return;
+			}
+
+			file_mapping file(_filename.c_str(), read_only);
+			mapped_region region(file, read_only, 0, _count * ENTRY_SIZE);
+			_region.swap(region);
+			_mappedCount = _count;
+		}
+	}
+}
\ No newline at end of file
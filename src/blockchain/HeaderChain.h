@@ -0,0 +1,89 @@
+
+#pragma once
+
+#include <string>
+#include <cstdio>
+
+#include <boost/thread.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+using std::string;
+using boost::interprocess::mapped_region;
+
+#include "MasterBlock.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		struct MasterBlockHeader {
+			uint32_t id;
+			uint16_t version;
+			uint32_t timestamp;
+			uint32_t target;
+			b256 previousHash;
+			b256 masterHash;
+			uint64_t nonce;
+			b256 hash;
+		};
+
+		// Fixed-stride file of the MasterBlock headers (as hashed for the proof of work), in chain order, kept
+		// alongside the chain segments. It is memory-mapped and, MasterBlock ids and timestamps growing along
+		// the chain, binary-searched, so header-only consumers never touch the MasterBlock bodies.
+		// Headers are never pruned, and the file can be rebuilt from the segments as long as they are whole.
+		class HeaderChain {
+
+		public: // CONSTANTS
+
+			static const size_t ENTRY_SIZE = MasterBlock::HEADER_SIZE;
+
+		private: // MEMBERS
+
+			string _filename;
+			std::FILE* _file;
+			size_t _count;
+			mutable mapped_region _region;
+			mutable size_t _mappedCount;
+			mutable boost::mutex _mutex;
+
+		public: // CONSTRUCTORS
+
+			HeaderChain(const string& filename);
+
+			virtual ~HeaderChain();
+
+		public: // METHODS
+
+			// A torn trailing entry left by a crash is cut off.
+			void open();
+			void close();
+
+			// Headers are derived from the chain segments, so they are flushed but not synced.
+			void append(const MasterBlock& mb);
+
+			// Keeps the first count headers only.
+			void truncate(size_t count);
+
+			size_t size() const;
+			bool getHeader(size_t i, MasterBlockHeader& header) const;
+			uint32_t getId(size_t i) const;
+			uint32_t getTimestamp(size_t i) const;
+
+			bool findById(uint32_t id, MasterBlockHeader& header) const;
+
+			// Position of the first header whose timestamp is not before the given one, or size() if none is.
+			size_t findByTimestamp(uint32_t timestamp) const;
+
+			// Checks the previous hash links and the proofs of work from the given position on, and returns
+			// the position of the first invalid header, or size() if they are all valid.
+			size_t validate(size_t from = 1) const;
+
+		private: // METHODS
+
+			const byte* getEntry(size_t i) const;
+			void remap() const;
+
+		};
+	}
+}
\ No newline at end of file
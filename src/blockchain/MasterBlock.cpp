@@ -11,13 +11,16 @@ namespace ecrp {
 	namespace blockchain {
 
 		MasterBlock::MasterBlock() {
+			_rawBlocks = NULL;
 		}
 
 		MasterBlock::MasterBlock(uint32_t id, uint32_t timestamp) {
 			_id = id;
+			_version = CURRENT_VERSION;
 			_timestamp = timestamp;
 			_target = 0;
 			_nonce = 0;
+			_rawBlocks = NULL;
 
 			memset(&_previousHash, 0, sizeof(_previousHash)); // TODO: create a dedicated function for that
 			memset(&_masterHash, 0, sizeof(_masterHash));
@@ -25,12 +28,14 @@ namespace ecrp {
 
 		MasterBlock::~MasterBlock() {
 			for (uint16_t i = 0; i < _blocks.size(); ++i) {
-				delete _blocks[i];
+				if (_blocks[i] != NULL && !_blocks[i]->isArenaAllocated()) {
+					delete _blocks[i];
+				}
 			}
 			_blocks.clear();
 		}
 
-		void MasterBlock::deserialize(be_ptr_istream& stream) {
+		void MasterBlock::deserialize(be_ptr_istream& stream, bool isLazy) {
 			stream >> _id;
 			stream >> _version;
 
@@ -46,15 +51,204 @@ namespace ecrp {
 
 			uint16_t blockCount;
 			stream >> blockCount;
+
+			if (_version < BLOCK_SIZES_VERSION) {
+				// Older records carry no block sizes, so their blocks cannot be located without being decoded.
+				reserveBlocks(blockCount);
+				for (uint16_t i = 0; i < blockCount; ++i) {
+					Block* t = _arena.create<Block>(&_arena);
+					_blocks.push_back(t);
+					t->deserialize(stream);
+				}
+				return;
+			}
+
+			_blockOffsets.resize(blockCount);
+			_blockSizes.resize(blockCount);
+
+			// summed on 64 bits, so that a malformed record cannot wrap the offsets around and pass the check
+			uint64_t offset = 0;
 			for (uint16_t i = 0; i < blockCount; ++i) {
-				Block* t = new Block();
-				t->deserialize(stream);
-				_blocks.push_back(t);
+				stream >> _blockSizes[i];
+				_blockOffsets[i] = (uint32_t)offset;
+				offset += _blockSizes[i];
+				if (offset > stream.get_remaining_size()) {
+					throw runtime_error("Truncated ecrp::blockchain::MasterBlock '" + std::to_string(_id) + "'.");
+				}
+			}
+
+			_blocks.assign(blockCount, NULL);
+
+			if (isLazy) {
+				_rawBlocks = stream.get_current_ptr();
+				stream.skip((size_t)offset);
+			} else {
+				reserveBlocks(blockCount);
+				for (uint16_t i = 0; i < blockCount; ++i) {
+					be_ptr_istream s(stream.get_current_ptr(), _blockSizes[i]);
+					Block* t = _arena.create<Block>(&_arena);
+					_blocks[i] = t;
+					t->deserialize(s);
+					if (s.get_remaining_size() != 0) {
+						throw runtime_error("Block '" + std::to_string(i) + "' does not fill its declared size in ecrp::blockchain::MasterBlock '" + std::to_string(_id) + "'.");
+					}
+					stream.skip(_blockSizes[i]);
+				}
 			}
 		}
 
+		void MasterBlock::deserialize(vector<byte>&& data, bool isLazy) {
+			_ownedData.swap(data);
+			be_ptr_istream s(_ownedData.data(), _ownedData.size());
+			deserialize(s, isLazy);
+
+			if (_rawBlocks == NULL) {
+				vector<byte>().swap(_ownedData);
+			}
+		}
+
+		void MasterBlock::reserveBlocks(uint16_t blockCount) {
+			// room for the Block objects and the alignment of the first one, the outputs of their transactions then take more chunks
+			_arena.reserve((size_t)blockCount * sizeof(Block) + alignof(Block));
+		}
+
+		void MasterBlock::serialize(be_ptr_ostream& stream) const {
+			if (_blocks.size() > UINT16_MAX) {
+				throw runtime_error("Too many blocks in ecrp::blockchain::MasterBlock '" + std::to_string(_id) + "'.");
+			}
+
+			// the version is part of the hashed header, so a MasterBlock keeps the one it was decoded with
+			stream << _id;
+			stream << _version;
+			stream << _timestamp;
+			stream << _target;
+			stream << _nonce;
+			stream << _previousHash;
+			stream << _masterHash;
+
+			stream << (uint16_t)_blocks.size();
+			if (_version >= BLOCK_SIZES_VERSION) {
+				for (uint16_t i = 0; i < _blocks.size(); ++i) {
+					stream << (uint32_t)getBlockSize(i);
+				}
+			}
+
+			for (uint16_t i = 0; i < _blocks.size(); ++i) {
+				if (_blocks[i] != NULL) {
+					_blocks[i]->serialize(stream);
+				} else {
+					stream.write(_rawBlocks + _blockOffsets[i], _blockSizes[i]);
+				}
+			}
+		}
+
+		void MasterBlock::serialize(vector<byte>& buffer) const {
+			buffer.resize(serializedSize());
+			be_ptr_ostream s(buffer);
+			serialize(s);
+		}
+
+		size_t MasterBlock::serializedSize() const {
+			size_t size = sizeof(_id) + sizeof(_version) + sizeof(_timestamp) + sizeof(_target) + sizeof(_nonce) + sizeof(_previousHash) + sizeof(_masterHash) + sizeof(uint16_t);
+			for (uint16_t i = 0; i < _blocks.size(); ++i) {
+				size += getBlockSize(i);
+			}
+			if (_version >= BLOCK_SIZES_VERSION) {
+				size += _blocks.size() * sizeof(uint32_t);
+			}
+			return size;
+		}
+
+		size_t MasterBlock::getBlockSize(uint16_t i) const {
+			return _blocks[i] != NULL ? _blocks[i]->serializedSize() : _blockSizes[i];
+		}
+
 		void MasterBlock::addBlock(Block* b) {
 			_blocks.push_back(b);
 		}
+
+		uint32_t MasterBlock::getId() const {
+			return _id;
+		}
+
+		uint16_t MasterBlock::getVersion() const {
+			return _version;
+		}
+
+		uint32_t MasterBlock::getTimestamp() const {
+			return _timestamp;
+		}
+
+		uint32_t MasterBlock::getTarget() const {
+			return _target;
+		}
+
+		void MasterBlock::serializeHeader(be_ptr_ostream& stream) const {
+			stream << _id;
+			stream << _version;
+			stream << _timestamp;
+			stream << _target;
+			stream << _previousHash;
+			stream << _masterHash;
+			stream << _nonce;
+		}
+
+		b256 MasterBlock::getHash() const {
+			byte header[HEADER_SIZE];
+			be_ptr_ostream stream(header, sizeof(header));
+			serializeHeader(stream);
+			return ecrp::crypto::sha256(header, sizeof(header));
+		}
+
+		void MasterBlock::setTarget(uint32_t target) {
+			_target = target;
+		}
+
+		void MasterBlock::setNonce(uint64_t nonce) {
+			_nonce = nonce;
+		}
+
+		void MasterBlock::setPreviousHash(const b256& hash) {
+			_previousHash = hash;
+		}
+
+		void MasterBlock::setMasterHash(const b256& hash) {
+			_masterHash = hash;
+		}
+
+		uint64_t MasterBlock::getNonce() const {
+			return _nonce;
+		}
+
+		const b256& MasterBlock::getPreviousHash() const {
+			return _previousHash;
+		}
+
+		const b256& MasterBlock::getMasterHash() const {
+			return _masterHash;
+		}
+
+		uint16_t MasterBlock::getBlockCount() const {
+			return (uint16_t)_blocks.size();
+		}
+
+		Block* MasterBlock::getBlock(uint16_t i) {
+			if (i >= _blocks.size()) {
+				throw runtime_error("Block index '" + std::to_string(i) + "' out of range in ecrp::blockchain::MasterBlock '" + std::to_string(_id) + "'.");
+			}
+
+			if (_blocks[i] == NULL) {
+				be_ptr_istream s(_rawBlocks + _blockOffsets[i], _blockSizes[i]);
+				// only kept once fully decoded, so that a failed decoding is not taken for a decoded block later
+				Block* t = _arena.create<Block>(&_arena);
+				t->deserialize(s);
+				if (s.get_remaining_size() != 0) {
+					throw runtime_error("Block '" + std::to_string(i) + "' does not fill its declared size in ecrp::blockchain::MasterBlock '" + std::to_string(_id) + "'.");
+				}
+				_blocks[i] = t;
+			}
+
+			return _blocks[i];
+		}
 	}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 using std::vector;
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
 using ecrp::crypto::b256;
 
 //----------------------------------------------------------------------
@@ -18,10 +19,18 @@ namespace ecrp {
 
 		class MasterBlock {
 
+		public: // CONSTANTS
+
+			static const size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(b256) + sizeof(b256) + sizeof(uint64_t);
+
 		private: // CONSTANTS
 
 			static const uint16_t MIN_COMPATIBLE_VERSION = 1;
-			static const uint16_t CURRENT_VERSION = 1;
+			static const uint16_t CURRENT_VERSION = 2;
+
+			// Starting with version 2, the block count is followed by the serialized size of every block,
+			// which lets a lazily deserialized MasterBlock locate any of its blocks without decoding the others.
+			static const uint16_t BLOCK_SIZES_VERSION = 2;
 
 		private: // MEMBERS
 
@@ -34,6 +43,21 @@ namespace ecrp {
 			b256 _masterHash;
 			vector<Block*> _blocks;
 
+			// Decoded blocks and their transactions are allocated here, so the whole tree is released at once.
+			Arena _arena;
+
+			// Lazy mode only: undecoded blocks are NULL in _blocks and are decoded from _rawBlocks on first access.
+			// _rawBlocks points into _ownedData when the MasterBlock was given its bytes.
+			const byte* _rawBlocks;
+			vector<byte> _ownedData;
+			vector<uint32_t> _blockOffsets;
+			vector<uint32_t> _blockSizes;
+
+		private: // METHODS
+
+			size_t getBlockSize(uint16_t i) const;
+			void reserveBlocks(uint16_t blockCount);
+
 		public: // CONSTRUCTORS
 
 			MasterBlock();
@@ -43,10 +67,43 @@ namespace ecrp {
 
 		public: // METHODS
 
-			void deserialize(be_ptr_istream& stream);
+			// In lazy mode only the header is decoded and the blocks are decoded on demand by getBlock(),
+			// so the bytes behind the stream must outlive the MasterBlock.
+			void deserialize(be_ptr_istream& stream, bool isLazy = false);
+
+			// Takes the bytes over, so that a lazy MasterBlock can be decoded from a buffer which does not outlive the
+			// call, e.g. an inflated record. They are released right away unless some blocks are left undecoded.
+			void deserialize(vector<byte>&& data, bool isLazy = false);
+
+			// Writes the version the MasterBlock was decoded with, in its layout, so that its hash does not change.
+			// Blocks that were never decoded are copied as raw bytes; older versions have none, being decoded at once.
+			void serialize(be_ptr_ostream& stream) const;
+			void serialize(vector<byte>& buffer) const;
+			size_t serializedSize() const;
+
+			// The header as it is hashed for the proof of work (HEADER_SIZE bytes). The nonce comes last so that
+			// a miner can compute the hash state of everything before it once and only hash the nonce per attempt.
+			void serializeHeader(be_ptr_ostream& stream) const;
+			b256 getHash() const;
 
 			void addBlock(Block* b);
 
+			void setTarget(uint32_t target);
+			void setNonce(uint64_t nonce);
+			void setPreviousHash(const b256& hash);
+			void setMasterHash(const b256& hash);
+
+			uint32_t getId() const;
+			uint16_t getVersion() const;
+			uint32_t getTimestamp() const;
+			uint32_t getTarget() const;
+			uint64_t getNonce() const;
+			const b256& getPreviousHash() const;
+			const b256& getMasterHash() const;
+
+			uint16_t getBlockCount() const;
+			Block* getBlock(uint16_t i);
+
 		};
 	}
 }
\ No newline at end of file
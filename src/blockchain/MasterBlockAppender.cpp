@@ -0,0 +1,446 @@
+
+#include <stdexcept>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+
+#include "MasterBlockAppender.h"
+#include "utils/streams.h"
+#include "utils/utils.h"
+#include "utils/compression.h"
+
+using std::runtime_error;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		MasterBlockAppender::MasterBlockAppender(SegmentManifest* manifest, MasterBlockIndex* index) {
+			_manifest = manifest;
+			_index = index;
+			_file = NULL;
+			_fileSegment = 0;
+			_segment = 0;
+			_appendedSize = 0;
+			_syncedSize = 0;
+			_segmentSize = DEFAULT_SEGMENT_SIZE;
+			_policy = SYNC_EVERY_BLOCK;
+			_threshold = 0;
+			_appendedCount = 0;
+			_committedCount = 0;
+			_isStopping = false;
+			_isCompressing = false;
+			_dictionary = std::make_shared<const vector<byte> >();
+		}
+
+		MasterBlockAppender::~MasterBlockAppender() {
+			try {
+				close();
+			} catch (const std::exception& e) {
+				std::cerr << "Closing the chain segments failed: " << e.what() << std::endl;
+			}
+		}
+
+		void MasterBlockAppender::open() {
+			if (_file) {
+				return;
+			}
+
+			if (_manifest->getSegmentCount() == 0) {
+				_manifest->addSegment();
+			}
+
+			SegmentInfo last = _manifest->getSegment(_manifest->getSegmentCount() - 1);
+			string filename = SegmentManifest::getSegmentFilename(last.number);
+			if (boost::filesystem::exists(filename) && boost::filesystem::file_size(filename) > last.size) {
+				boost::filesystem::resize_file(filename, last.size);
+			}
+
+			openSegment(last.number);
+
+			_segment = last.number;
+			_appendedSize = boost::filesystem::file_size(filename);
+			_syncedSize = _appendedSize;
+			_pending.reserve(INITIAL_BUFFER_SIZE);
+			_error = nullptr;
+
+			startFlusher();
+		}
+
+		void MasterBlockAppender::close() {
+			if (!_file) {
+				return;
+			}
+
+			stopFlusher();
+
+			// the segment is closed even when the last commit fails, and the failure is reported afterwards
+			std::exception_ptr error;
+			try {
+				commit();
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			if (_file) {
+				std::fclose(_file);
+				_file = NULL;
+			}
+
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+
+		bool MasterBlockAppender::isOpen() const {
+			return _file != NULL;
+		}
+
+		void MasterBlockAppender::setSyncPolicy(SyncPolicy policy, uint64_t threshold) {
+			bool isOpen = _file != NULL;
+			if (isOpen) {
+				stopFlusher();
+				commit();
+			}
+
+			_policy = policy;
+			_threshold = threshold;
+
+			if (isOpen) {
+				startFlusher();
+			}
+		}
+
+		uint64_t MasterBlockAppender::append(const MasterBlock* mb) {
+			uint32_t length = (uint32_t)mb->serializedSize();
+
+			// compression is the costly part of an append, so it is done before the lock is taken
+			vector<byte> compressed;
+			bool isCompressing;
+			std::shared_ptr<const vector<byte> > dictionary;
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				isCompressing = _isCompressing;
+				dictionary = _dictionary;
+			}
+			if (isCompressing) {
+				compressRecord(mb, length, *dictionary, compressed);
+			}
+
+			uint64_t sequence;
+			bool isCommitNeeded;
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+
+				if (!_file) {
+					throw runtime_error("The chain segments are not open for appending.");
+				}
+
+				if (_error) {
+					std::rethrow_exception(_error);
+				}
+
+				// The record is serialized in place at the end of the pending buffer, so a whole batch is written with a single call.
+				if (!compressed.empty()) {
+					length = (uint32_t)compressed.size();
+				}
+				size_t position = _pending.size();
+				_pending.resize(position + sizeof(length) + length);
+				be_ptr_ostream s(_pending.data() + position, sizeof(length) + length);
+				if (compressed.empty()) {
+					s << length;
+					mb->serialize(s);
+				} else {
+					s << (length | COMPRESSED_RECORD_FLAG);
+					s.write(compressed.data(), compressed.size());
+				}
+
+				if (_appendedSize > 0 && _appendedSize + sizeof(length) + length > _segmentSize) {
+					++_segment;
+					_appendedSize = 0;
+				}
+
+				PendingEntry entry;
+				entry.id = mb->getId();
+				entry.sequence = sequence = _appendedCount++;
+				entry.location.segment = _segment;
+				entry.location.offset = _appendedSize + sizeof(length);
+				entry.location.length = length;
+				entry.location.isCompressed = !compressed.empty();
+				_pendingEntries.push_back(entry);
+				_appendedSize += sizeof(length) + length;
+
+				isCommitNeeded = _policy == SYNC_EVERY_BLOCK || (_policy == SYNC_EVERY_N_BYTES && _pending.size() >= _threshold);
+			}
+
+			if (isCommitNeeded) {
+				commit();
+			}
+			return sequence;
+		}
+
+		void MasterBlockAppender::commit() {
+			boost::lock_guard<boost::mutex> commitLock(_commitMutex);
+
+			// The pending records are taken out of the buffer first, so that appends can go on during the fsync.
+			vector<byte> batch;
+			vector<PendingEntry> entries;
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				if (_error) {
+					std::rethrow_exception(_error);
+				}
+				batch.swap(_pending);
+				entries.swap(_pendingEntries);
+				_pending.reserve(batch.capacity());
+			}
+
+			if (batch.empty()) {
+				return;
+			}
+
+			// The batch is written segment by segment. Before the next segment is opened, which seals the
+			// previous one in the manifest, the previous one is synced and its records indexed.
+			size_t position = 0;
+			size_t indexedCount = 0;
+			uint64_t writtenSize = 0;
+			try {
+				for (size_t i = 0; i < entries.size(); ) {
+					uint32_t segment = entries[i].location.segment;
+					size_t first = i;
+					size_t size = 0;
+					for (; i < entries.size() && entries[i].location.segment == segment; ++i) {
+						size += sizeof(uint32_t) + entries[i].location.length;
+					}
+
+					if (segment != _fileSegment) {
+						syncSegment();
+						_syncedSize += writtenSize;
+						writtenSize = 0;
+						indexEntries(entries, indexedCount, first);
+						indexedCount = first;
+
+						if (_manifest->addSegment() != segment) {
+							throw runtime_error("Unexpected chain segment '" + std::to_string(segment) + "'.");
+						}
+						openSegment(segment);
+						_syncedSize = 0;
+					}
+
+					if (std::fwrite(batch.data() + position, size, 1, _file) != 1) {
+						throw runtime_error("Writing to the chain segment '" + SegmentManifest::getSegmentFilename(segment) + "' failed.");
+					}
+					position += size;
+					writtenSize += size;
+				}
+
+				syncSegment();
+				_syncedSize += writtenSize;
+			} catch (...) {
+				rollBack(std::current_exception());
+				throw;
+			}
+
+			indexEntries(entries, indexedCount, entries.size());
+		}
+
+		void MasterBlockAppender::rollBack(std::exception_ptr error) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			// Part of what was written since the last sync may have reached the disk, so it is cut off. The stream is
+			// closed before the cut, so that none of its buffered bytes can land past it afterwards.
+			if (_file) {
+				std::fclose(_file);
+				_file = NULL;
+			}
+			try {
+				boost::filesystem::resize_file(SegmentManifest::getSegmentFilename(_fileSegment), _syncedSize);
+				openSegment(_fileSegment);
+			} catch (...) {
+				// the appender stays closed
+			}
+
+			// a segment added to the manifest but which could not be opened holds nothing
+			try {
+				size_t segmentCount = _manifest->getSegmentCount();
+				if (segmentCount > 1 && _manifest->getSegment(segmentCount - 1).number > _fileSegment) {
+					_manifest->removeLastSegment();
+				}
+			} catch (...) {
+				// the segment is dropped when the chain is loaded again
+			}
+
+			// The records appended during the failed commit were placed after the failed ones, so they are dropped
+			// too, and the error is reported by every later append or commit until the segments are reopened.
+			_pending.clear();
+			_pendingEntries.clear();
+			_segment = _fileSegment;
+			_appendedSize = _syncedSize;
+			_appendedCount = _committedCount;
+			_error = error;
+		}
+
+		uint64_t MasterBlockAppender::getCommittedCount() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _committedCount;
+		}
+
+		bool MasterBlockAppender::hasFailed() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _error != nullptr;
+		}
+
+		bool MasterBlockAppender::canRemoveLast(const MasterBlockLocation& location) {
+			commit();
+
+			boost::lock_guard<boost::mutex> commitLock(_commitMutex);
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _file && isLast(location);
+		}
+
+		void MasterBlockAppender::removeLast(const MasterBlockLocation& location) {
+			commit();
+
+			boost::lock_guard<boost::mutex> commitLock(_commitMutex);
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (!_file) {
+				throw runtime_error("The chain segments are not open for appending.");
+			}
+
+			if (!isLast(location)) {
+				throw runtime_error("Only the last record of the chain can be removed.");
+			}
+
+			// the segment is opened in append mode, so the next record goes right where this one began
+			_appendedSize = location.offset - sizeof(uint32_t);
+			std::fflush(_file);
+			boost::filesystem::resize_file(SegmentManifest::getSegmentFilename(_fileSegment), _appendedSize);
+			syncSegment();
+			_syncedSize = _appendedSize;
+
+			// The next record to remove is the last one of the previous segment, which is sealed and whole.
+			size_t segmentCount = _manifest->getSegmentCount();
+			if (_appendedSize == 0 && segmentCount > 1 && _manifest->getSegment(segmentCount - 1).number == _fileSegment) {
+				uint32_t previous = _manifest->getSegment(segmentCount - 2).number;
+				openSegment(previous);
+				_manifest->removeLastSegment();
+				_segment = previous;
+				_appendedSize = boost::filesystem::file_size(SegmentManifest::getSegmentFilename(previous));
+				_syncedSize = _appendedSize;
+			}
+		}
+
+		bool MasterBlockAppender::isLast(const MasterBlockLocation& location) const {
+			return location.segment == _fileSegment && location.offset + location.length == _appendedSize && _pending.empty();
+		}
+
+		void MasterBlockAppender::syncSegment() {
+			if (!ecrp::syncFile(_file)) {
+				throw runtime_error("Syncing the chain segment '" + SegmentManifest::getSegmentFilename(_fileSegment) + "' failed.");
+			}
+		}
+
+		void MasterBlockAppender::indexEntries(const vector<PendingEntry>& entries, size_t begin, size_t end) {
+			if (begin == end) {
+				return;
+			}
+
+			if (_index) {
+				for (size_t i = begin; i < end; ++i) {
+					_index->append(entries[i].id, entries[i].location);
+				}
+			}
+
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_committedCount = entries[end - 1].sequence + 1;
+		}
+
+		void MasterBlockAppender::compressRecord(const MasterBlock* mb, uint32_t length, const vector<byte>& dictionary, vector<byte>& output) {
+			vector<byte> raw(length);
+			be_ptr_ostream s(raw.data(), raw.size());
+			mb->serialize(s);
+
+			// The id stays in clear so that the index can be rebuilt without decompressing anything.
+			output.resize(sizeof(uint32_t) + sizeof(uint32_t));
+			be_ptr_ostream header(output.data(), output.size());
+			header << mb->getId();
+			header << length;
+			ecrp::compress(raw.data(), raw.size(), dictionary, output);
+
+			// a record which does not shrink is kept raw
+			if (output.size() >= raw.size()) {
+				output.clear();
+			}
+		}
+
+		void MasterBlockAppender::setCompression(bool isCompressing, const vector<byte>& dictionary) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_isCompressing = isCompressing;
+			_dictionary = std::make_shared<const vector<byte> >(dictionary);
+		}
+
+		void MasterBlockAppender::setSegmentSize(uint64_t segmentSize) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			_segmentSize = segmentSize;
+		}
+
+		void MasterBlockAppender::openSegment(uint32_t segment) {
+			string filename = SegmentManifest::getSegmentFilename(segment);
+			std::FILE* file = std::fopen(filename.c_str(), "ab");
+			if (!file) {
+				throw runtime_error("Unable to open the chain segment '" + filename + "' for appending.");
+			}
+
+			if (_file) {
+				std::fclose(_file);
+			}
+			_file = file;
+			_fileSegment = segment;
+		}
+
+		void MasterBlockAppender::startFlusher() {
+			if (_policy != SYNC_EVERY_N_MILLISECONDS) {
+				return;
+			}
+
+			_isStopping = false;
+			_flusher = boost::thread(&MasterBlockAppender::runFlusher, this);
+		}
+
+		void MasterBlockAppender::stopFlusher() {
+			if (!_flusher.joinable()) {
+				return;
+			}
+
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				_isStopping = true;
+			}
+			_condition.notify_all();
+			_flusher.join();
+		}
+
+		void MasterBlockAppender::runFlusher() {
+			boost::unique_lock<boost::mutex> lock(_mutex);
+
+			while (!_isStopping) {
+				_condition.timed_wait(lock, boost::posix_time::milliseconds(std::max<uint64_t>(1, _threshold)));
+
+				if (!_isStopping && !_pending.empty()) {
+					lock.unlock();
+					try {
+						commit();
+					} catch (...) {
+						// The failed commit left its error for the next append, since nobody waits on this thread.
+						lock.lock();
+						break;
+					}
+					lock.lock();
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <exception>
+#include <memory>
+
+#include <boost/thread.hpp>
+
+#include "MasterBlock.h"
+#include "MasterBlockIndex.h"
+#include "SegmentManifest.h"
+
+using std::string;
+using std::vector;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		enum SyncPolicy {
+			SYNC_EVERY_BLOCK = 0,
+			SYNC_EVERY_N_MILLISECONDS = 1,
+			SYNC_EVERY_N_BYTES = 2
+		};
+
+		// Appends length-prefixed MasterBlock records to the last chain segment. Records are serialized into a pending
+		// buffer and several of them are written and fsync'ed together (group commit), according to the sync policy.
+		// Index entries are only added once their record is durable. A record which would make the segment exceed
+		// the segment size goes to a new segment, and a record never spans two segments.
+		// With compression on, a record is deflated with the preset dictionary and flagged in its length prefix,
+		// and its payload is the MasterBlock id, the serialized size and the deflated MasterBlock.
+		class MasterBlockAppender {
+
+		private: // CONSTANTS
+
+			static const size_t INITIAL_BUFFER_SIZE = 1 << 20;
+			static const uint64_t DEFAULT_SEGMENT_SIZE = 128 << 20;
+
+		private: // MEMBERS
+
+			struct PendingEntry {
+				uint32_t id;
+				uint64_t sequence;
+				MasterBlockLocation location;
+			};
+
+			SegmentManifest* _manifest;
+			MasterBlockIndex* _index;
+			std::FILE* _file;
+			uint32_t _fileSegment;
+			uint32_t _segment;
+			uint64_t _appendedSize;
+			uint64_t _syncedSize;
+			uint64_t _segmentSize;
+			bool _isCompressing;
+			std::shared_ptr<const vector<byte> > _dictionary;
+
+			SyncPolicy _policy;
+			uint64_t _threshold;
+
+			vector<byte> _pending;
+			vector<PendingEntry> _pendingEntries;
+			uint64_t _appendedCount;
+			uint64_t _committedCount;
+			mutable boost::mutex _mutex;
+			boost::mutex _commitMutex;
+			boost::condition_variable _condition;
+			boost::thread _flusher;
+			bool _isStopping;
+			std::exception_ptr _error;
+
+		public: // CONSTRUCTORS
+
+			MasterBlockAppender(SegmentManifest* manifest, MasterBlockIndex* index);
+
+			virtual ~MasterBlockAppender();
+
+		public: // METHODS
+
+			// Anything past the last indexed record of the last segment is a torn record left by a crash
+			// and is cut off before appending.
+			void open();
+			void close();
+			bool isOpen() const;
+
+			// The threshold is a number of milliseconds or bytes depending on the policy, and is ignored by SYNC_EVERY_BLOCK.
+			void setSyncPolicy(SyncPolicy policy, uint64_t threshold = 0);
+			void setSegmentSize(uint64_t segmentSize);
+			void setCompression(bool isCompressing, const vector<byte>& dictionary);
+
+			// Returns the sequence number of the record, which is durable once getCommittedCount() is past it.
+			uint64_t append(const MasterBlock* mb);
+
+			// When a write or a sync fails, the last segment is cut back to its last synced size and the records
+			// not yet committed are dropped. The error is then rethrown by every append and commit until reopening.
+			// A commit of the flusher thread may fail that way too, so a caller seeing an error checks hasFailed()
+			// and getCommittedCount() to learn which of its records were lost.
+			void commit();
+
+			uint64_t getCommittedCount() const;
+			bool hasFailed() const;
+
+			// Commits the pending records and tells whether the record at the given location is the last one appended.
+			bool canRemoveLast(const MasterBlockLocation& location);
+
+			// Cuts the record at the given location off its segment after committing the pending ones.
+			// It must be the last record appended. A segment left empty is dropped and the previous one
+			// is appended to again, so that its last record can be removed next.
+			void removeLast(const MasterBlockLocation& location);
+
+		private: // METHODS
+
+			static void compressRecord(const MasterBlock* mb, uint32_t length, const vector<byte>& dictionary, vector<byte>& output);
+			void openSegment(uint32_t segment);
+			void syncSegment();
+			void rollBack(std::exception_ptr error);
+			bool isLast(const MasterBlockLocation& location) const;
+			void indexEntries(const vector<PendingEntry>& entries, size_t begin, size_t end);
+			void startFlusher();
+			void stopFlusher();
+			void runFlusher();
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+
+#include <stdexcept>
+#include <cstdio>
+
+#include <boost/filesystem.hpp>
+
+#include "MasterBlockIndex.h"
+#include "utils/streams.h"
+#include "utils/utils.h"
+
+using std::runtime_error;
+using ecrp::io::be_file_istream;
+using ecrp::io::be_file_ostream;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		MasterBlockIndex::MasterBlockIndex(SegmentManifest* manifest, const string& indexFilename) {
+			_manifest = manifest;
+			_indexFilename = indexFilename;
+			_isLoaded = false;
+		}
+
+		MasterBlockIndex::~MasterBlockIndex() {
+		}
+
+		void MasterBlockIndex::init() {
+			if (_isLoaded) {
+				return;
+			}
+
+			_locations.clear();
+			_manifest->clearRecords();
+
+			load();
+
+			vector<SegmentInfo> segments = _manifest->getSegments();
+
+			for (size_t i = 0; i < segments.size(); ++i) {
+				string filename = SegmentManifest::getSegmentFilename(segments[i].number);
+				uint64_t dataSize = boost::filesystem::exists(filename) ? boost::filesystem::file_size(filename) : 0;
+
+				if (segments[i].size > dataSize) {
+					// A segment was truncated or replaced, so none of the entries can be trusted anymore.
+					_locations.clear();
+					_manifest->clearRecords();
+					boost::filesystem::remove(_indexFilename);
+					segments = _manifest->getSegments();
+					break;
+				}
+			}
+
+			for (size_t i = 0; i < segments.size(); ++i) {
+				string filename = SegmentManifest::getSegmentFilename(segments[i].number);
+				uint64_t dataSize = boost::filesystem::exists(filename) ? boost::filesystem::file_size(filename) : 0;
+
+				if (segments[i].size < dataSize) {
+					scan(segments[i]);
+				}
+			}
+
+			_isLoaded = true;
+		}
+
+		void MasterBlockIndex::load() {
+			if (!boost::filesystem::exists(_indexFilename)) {
+				return;
+			}
+
+			long entryCount;
+			bool isTorn;
+			{
+				be_file_istream fs(_indexFilename.c_str());
+				if (!fs.is_open()) {
+					throw runtime_error("Unable to open the MasterBlock index '" + _indexFilename + "'.");
+				}
+
+				entryCount = fs._file_length() / ENTRY_SIZE;
+				isTorn = fs._file_length() % ENTRY_SIZE != 0;
+
+				for (long i = 0; i < entryCount; ++i) {
+					uint32_t id;
+					MasterBlockLocation location;
+					fs >> id;
+					fs >> location.segment;
+					fs >> location.offset;
+					fs >> location.length;
+					location.isCompressed = (location.length & COMPRESSED_RECORD_FLAG) != 0;
+					location.length &= ~COMPRESSED_RECORD_FLAG;
+					add(id, location);
+				}
+			}
+
+			if (isTorn) {
+				// An interrupted append left half an entry behind, drop it so that new entries stay aligned.
+				boost::filesystem::resize_file(_indexFilename, entryCount * ENTRY_SIZE);
+			}
+		}
+
+		void MasterBlockIndex::scan(const SegmentInfo& segment) {
+			string filename = SegmentManifest::getSegmentFilename(segment.number);
+			be_file_istream fs(filename.c_str());
+			if (!fs.is_open()) {
+				throw runtime_error("Unable to open the chain segment '" + filename + "'.");
+			}
+
+			be_file_ostream os(_indexFilename.c_str(), true);
+			if (!os.is_open()) {
+				throw runtime_error("Unable to open the MasterBlock index '" + _indexFilename + "'.");
+			}
+
+			// Only the length prefix and the id (the first field of a MasterBlock, and of a compressed record) are read from each record.
+			uint64_t size = fs._file_length();
+			uint64_t position = segment.size;
+
+			while (position + sizeof(uint32_t) + sizeof(uint32_t) <= size) {
+				uint32_t length;
+				uint32_t id;
+				fs.seekg((int64_t)position);
+				fs >> length;
+				fs >> id;
+
+				MasterBlockLocation location;
+				location.segment = segment.number;
+				location.offset = position + sizeof(length);
+				location.length = length & ~COMPRESSED_RECORD_FLAG;
+				location.isCompressed = (length & COMPRESSED_RECORD_FLAG) != 0;
+				if (location.offset + location.length > size) {
+					break; // torn trailing record, cut off before appending
+				}
+
+				add(id, location);
+				os << id << location.segment << location.offset << length;
+
+				position = location.offset + location.length;
+			}
+		}
+
+		void MasterBlockIndex::add(uint32_t id, const MasterBlockLocation& location) {
+			if (_manifest->addRecord(location.segment, id, location.offset + location.length)) {
+				_locations[id] = location;
+			}
+		}
+
+		void MasterBlockIndex::append(uint32_t id, const MasterBlockLocation& location) {
+			add(id, location);
+
+			be_file_ostream os(_indexFilename.c_str(), true);
+			if (!os.is_open()) {
+				throw runtime_error("Unable to open the MasterBlock index '" + _indexFilename + "'.");
+			}
+			os << id << location.segment << location.offset << (location.isCompressed ? location.length | COMPRESSED_RECORD_FLAG : location.length);
+		}
+
+		bool MasterBlockIndex::find(uint32_t id, MasterBlockLocation& location) const {
+			auto t = _locations.find(id);
+			if (t != _locations.end()) {
+				location = t->second;
+				return true;
+			} else {
+				return false;
+			}
+		}
+
+		size_t MasterBlockIndex::size() const {
+			return _locations.size();
+		}
+
+		void MasterBlockIndex::removeLast(uint32_t id, uint32_t previousId) {
+			auto i = _locations.find(id);
+			if (i == _locations.end()) {
+				return;
+			}
+
+			MasterBlockLocation location = i->second;
+			_locations.erase(i);
+			_manifest->removeLastRecord(location.segment, previousId, location.offset - sizeof(uint32_t));
+
+			// the entry is the last one of the file, unless the index was rebuilt since
+			uint64_t size = boost::filesystem::exists(_indexFilename) ? boost::filesystem::file_size(_indexFilename) : 0;
+			if (size >= ENTRY_SIZE) {
+				uint32_t lastId;
+				{
+					be_file_istream fs(_indexFilename.c_str());
+					if (!fs.is_open()) {
+						throw runtime_error("Unable to open the MasterBlock index '" + _indexFilename + "'.");
+					}
+					fs.seekg((int64_t)(size - size % ENTRY_SIZE - ENTRY_SIZE));
+					fs >> lastId;
+				}
+				if (lastId == id) {
+					boost::filesystem::resize_file(_indexFilename, size - size % ENTRY_SIZE - ENTRY_SIZE);
+				}
+			}
+		}
+
+		void MasterBlockIndex::removeSegmentsBefore(uint32_t segment) {
+			for (auto i = _locations.begin(); i != _locations.end(); ) {
+				if (i->second.segment < segment) {
+					i = _locations.erase(i);
+				} else {
+					++i;
+				}
+			}
+
+			compact(segment);
+		}
+
+		void MasterBlockIndex::compact(uint32_t segment) {
+			if (!boost::filesystem::exists(_indexFilename)) {
+				return;
+			}
+
+			vector<byte> buffer;
+			{
+				be_file_istream fs(_indexFilename.c_str());
+				if (!fs.is_open()) {
+					throw runtime_error("Unable to open the MasterBlock index '" + _indexFilename + "'.");
+				}
+
+				long entryCount = fs._file_length() / ENTRY_SIZE;
+				buffer.resize(entryCount * ENTRY_SIZE);
+				be_ptr_ostream os(buffer.data(), buffer.size());
+
+				for (long i = 0; i < entryCount; ++i) {
+					uint32_t id;
+					uint32_t entrySegment;
+					uint64_t offset;
+					uint32_t length;
+					fs >> id;
+					fs >> entrySegment;
+					fs >> offset;
+					fs >> length;
+					if (entrySegment >= segment) {
+						os << id << entrySegment << offset << length;
+					}
+				}
+				buffer.resize(os.tellp());
+			}
+
+			// written aside and renamed over the previous index, so that a crash leaves either of them whole
+			// (the entries of the pruned segments, which the previous one still holds, are skipped on load)
+			string tempFilename = _indexFilename + ".tmp";
+			std::FILE* file = std::fopen(tempFilename.c_str(), "wb");
+			if (file == NULL) {
+				throw runtime_error("Unable to create the MasterBlock index '" + tempFilename + "'.");
+			}
+			bool isWritten = (buffer.empty() || std::fwrite(buffer.data(), buffer.size(), 1, file) == 1) && ecrp::syncFile(file);
+			std::fclose(file);
+			if (!isWritten) {
+				boost::filesystem::remove(tempFilename);
+				throw runtime_error("Writing the MasterBlock index '" + tempFilename + "' failed.");
+			}
+			boost::filesystem::rename(tempFilename, _indexFilename);
+		}
+	}
+}
\ No newline at end of file
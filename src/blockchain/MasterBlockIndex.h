@@ -0,0 +1,73 @@
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+using std::string;
+using std::unordered_map;
+
+#include "SegmentManifest.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Set in the length prefix of a record (and of an index entry) whose payload is compressed.
+		const uint32_t COMPRESSED_RECORD_FLAG = 0x80000000;
+
+		struct MasterBlockLocation {
+			uint32_t segment;
+			uint64_t offset; // position of the record payload inside its segment, right after its length prefix
+			uint32_t length;
+			bool isCompressed;
+		};
+
+		// Sidecar index mapping each MasterBlock id to the position of its record inside the chain segments.
+		// Entries are fixed-size (id, segment, offset, length) tuples appended in chain order, and the index is
+		// rebuilt (or completed) from the segments whenever it is missing or lagging behind them. The figures
+		// of the segment manifest are derived from the index entries.
+		class MasterBlockIndex {
+
+		private: // CONSTANTS
+
+			static const size_t ENTRY_SIZE = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+		private: // MEMBERS
+
+			SegmentManifest* _manifest;
+			string _indexFilename;
+			unordered_map<uint32_t, MasterBlockLocation> _locations;
+			bool _isLoaded;
+
+		public: // CONSTRUCTORS
+
+			MasterBlockIndex(SegmentManifest* manifest, const string& indexFilename);
+
+			virtual ~MasterBlockIndex();
+
+		public: // METHODS
+
+			void init();
+
+			void append(uint32_t id, const MasterBlockLocation& location);
+			bool find(uint32_t id, MasterBlockLocation& location) const;
+			size_t size() const;
+
+			// Forgets the entry of the last MasterBlock, which must be the last one appended.
+			void removeLast(uint32_t id, uint32_t previousId);
+
+			// Forgets the entries of the pruned segments and rewrites the index file without them.
+			void removeSegmentsBefore(uint32_t segment);
+
+		private: // METHODS
+
+			void load();
+			void scan(const SegmentInfo& segment);
+			void add(uint32_t id, const MasterBlockLocation& location);
+			void compact(uint32_t segment);
+
+		};
+	}
+}
\ No newline at end of file
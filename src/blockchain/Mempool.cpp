@@ -0,0 +1,204 @@
+
+#include <cstring>
+
+#include "Mempool.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		static const size_t DEFAULT_MAX_USAGE = 300 * 1024 * 1024;
+
+		size_t Mempool::IdHash::operator()(const b120& id) const {
+			// ids are truncated hashes, any of their bytes will do
+			size_t h;
+			memcpy(&h, id.b, sizeof(h));
+			return h;
+		}
+
+		bool Mempool::IdEqual::operator()(const b120& a, const b120& b) const {
+			return memcmp(a.b, b.b, sizeof(a.b)) == 0;
+		}
+
+		bool Mempool::FeeDensityLess::operator()(const Entry* a, const Entry* b) const {
+			if (a->feeDensity != b->feeDensity) {
+				return a->feeDensity < b->feeDensity;
+			}
+			return memcmp(a->id.b, b->id.b, sizeof(a->id.b)) < 0;
+		}
+
+		Mempool::Mempool(const UtxoSet* utxos) {
+			_utxos = utxos;
+			_validator = NULL;
+			_usage = 0;
+			_maxUsage = DEFAULT_MAX_USAGE;
+		}
+
+		Mempool::~Mempool() {
+		}
+
+		void Mempool::setValidator(const BlockValidator* validator) {
+			_validator = validator;
+		}
+
+		void Mempool::setMaxUsage(size_t maxUsage) {
+			_maxUsage = maxUsage;
+			evict();
+		}
+
+		bool Mempool::add(const TransactionVariant& t) {
+			const BasicTransaction* bt = boost::get<BasicTransaction>(&t);
+			if (bt == NULL) {
+				return false;
+			}
+
+			b120 id = getTransactionId(t);
+			if (_entries.count(id) > 0) {
+				return false;
+			}
+
+			OutPoint spent;
+			spent.source = bt->getInput().source;
+			spent.outputId = bt->getInput().sourceOutputId;
+			if (_spentOutputs.count(spent) > 0) {
+				return false;
+			}
+
+			TransactionOutput input;
+			if (!_utxos->find(spent, input)) {
+				return false;
+			}
+
+			uint64_t outputAmount = 0;
+			const TransactionOutputs& outputs = bt->getOutputs();
+			for (size_t i = 0; i < outputs.size(); ++i) {
+				if (outputs[i].amount > input.amount - outputAmount) {
+					return false; // spends more than its input
+				}
+				outputAmount += outputs[i].amount;
+			}
+			if (outputAmount == input.amount) {
+				return false;
+			}
+
+			// the most expensive check comes last
+			if (_validator && !_validator->verify(*bt)) {
+				return false;
+			}
+
+			Entry& e = _entries[id];
+			e.transaction = t;
+			e.id = id;
+			e.spent = spent;
+			e.fee = input.amount - outputAmount;
+			e.size = bt->serializedSize();
+			e.feeDensity = (double)e.fee / e.size;
+
+			_spentOutputs[spent] = &e;
+			_byFeeDensity.insert(&e);
+			_usage += sizeof(Entry) + ENTRY_OVERHEAD + e.size;
+
+			evict();
+			return _entries.count(id) > 0;
+		}
+
+		bool Mempool::remove(const b120& id) {
+			auto i = _entries.find(id);
+			if (i == _entries.end()) {
+				return false;
+			}
+			erase(i->second);
+			return true;
+		}
+
+		bool Mempool::contains(const b120& id) const {
+			return _entries.count(id) > 0;
+		}
+
+		void Mempool::removeForBlock(const Block& b) {
+			vector<byte> buffer;
+			for (uint16_t k = 0; k < b.getTransactionCount(); ++k) {
+				const TransactionVariant& t = b.getTransaction(k);
+
+				auto i = _entries.find(getTransactionId(t, buffer));
+				if (i != _entries.end()) {
+					erase(i->second);
+				}
+
+				// any pooled transaction spending the same output can no longer be included
+				const TransactionInput* input = getTransactionInput(t);
+				if (input) {
+					OutPoint spent;
+					spent.source = input->source;
+					spent.outputId = input->sourceOutputId;
+					auto j = _spentOutputs.find(spent);
+					if (j != _spentOutputs.end()) {
+						erase(*j->second);
+					}
+				}
+			}
+		}
+
+		void Mempool::removeForMasterBlock(MasterBlock& mb) {
+			for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+				removeForBlock(*mb.getBlock(i));
+			}
+		}
+
+		void Mempool::restoreForMasterBlock(MasterBlock& mb, const UtxoUndo& undo) {
+			for (size_t i = 0; i < undo.created.size(); ++i) {
+				auto j = _spentOutputs.find(undo.created[i]);
+				if (j != _spentOutputs.end()) {
+					erase(*j->second);
+				}
+			}
+
+			for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+				const Block& b = *mb.getBlock(i);
+				for (uint16_t k = 0; k < b.getTransactionCount(); ++k) {
+					add(b.getTransaction(k));
+				}
+			}
+		}
+
+		void Mempool::getTransactionsForBlock(size_t maxSize, vector<TransactionVariant>& transactions) const {
+			size_t size = 0;
+			for (auto i = _byFeeDensity.rbegin(); i != _byFeeDensity.rend(); ++i) {
+				if (size + (*i)->size <= maxSize) {
+					transactions.push_back((*i)->transaction);
+					size += (*i)->size;
+				}
+			}
+		}
+
+		size_t Mempool::size() const {
+			return _entries.size();
+		}
+
+		size_t Mempool::getUsage() const {
+			return _usage;
+		}
+
+		void Mempool::clear() {
+			_byFeeDensity.clear();
+			_spentOutputs.clear();
+			_entries.clear();
+			_usage = 0;
+		}
+
+		void Mempool::erase(const Entry& e) {
+			b120 id = e.id; // e belongs to _entries, so it is erased last
+			_usage -= sizeof(Entry) + ENTRY_OVERHEAD + e.size;
+			_byFeeDensity.erase(&e);
+			_spentOutputs.erase(e.spent);
+			_entries.erase(id);
+		}
+
+		void Mempool::evict() {
+			while (_usage > _maxUsage && !_byFeeDensity.empty()) {
+				erase(**_byFeeDensity.begin());
+			}
+		}
+	}
+}
\ No newline at end of file
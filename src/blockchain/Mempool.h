@@ -0,0 +1,113 @@
+
+#pragma once
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+using std::vector;
+using std::set;
+using std::unordered_map;
+
+#include "crypto/Crypto.h"
+#include "TransactionVariant.h"
+#include "UtxoSet.h"
+#include "BlockValidator.h"
+
+using ecrp::crypto::b120;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Pool of the transactions waiting to be included in a block. Entries are indexed by txid and by the
+		// output they spend, which gives constant-time dedupe and conflict detection, and are kept ordered by
+		// fee density (fee per serialized byte) for block assembly and eviction. Only basic transactions
+		// spending outputs of the UTXO set are admitted, and their signature is checked once a validator is set.
+		class Mempool {
+
+		private: // CONSTANTS
+
+			// Rough cost of the indexes (hash nodes, tree node) on top of an entry and its transaction.
+			static const size_t ENTRY_OVERHEAD = 192;
+
+		private: // TYPES
+
+			struct Entry {
+				TransactionVariant transaction;
+				b120 id;
+				OutPoint spent;
+				uint64_t fee;
+				size_t size;
+				double feeDensity;
+			};
+
+			struct IdHash {
+				size_t operator()(const b120& id) const;
+			};
+
+			struct IdEqual {
+				bool operator()(const b120& a, const b120& b) const;
+			};
+
+			// Ascending fee density, ties broken by txid so that the order is strict.
+			struct FeeDensityLess {
+				bool operator()(const Entry* a, const Entry* b) const;
+			};
+
+		private: // MEMBERS
+
+			const UtxoSet* _utxos;
+			const BlockValidator* _validator;
+			unordered_map<b120, Entry, IdHash, IdEqual> _entries;
+			unordered_map<OutPoint, const Entry*, OutPointHash, OutPointEqual> _spentOutputs;
+			set<const Entry*, FeeDensityLess> _byFeeDensity;
+			size_t _usage;
+			size_t _maxUsage;
+
+		public: // CONSTRUCTORS
+
+			Mempool(const UtxoSet* utxos);
+
+			virtual ~Mempool();
+
+		public: // METHODS
+
+			// The validator remembers the signatures found valid here, so they are not checked again in a block.
+			void setValidator(const BlockValidator* validator);
+
+			// Evicts the entries with the lowest fee density until the pool fits in the new cap.
+			void setMaxUsage(size_t maxUsage);
+
+			// Returns false if the transaction is already pooled, is not a basic transaction, spends an output
+			// missing from the UTXO set or already spent by a pooled one, pays no fee, has an invalid signature,
+			// or is evicted right away because the pool is full of transactions paying better.
+			bool add(const TransactionVariant& t);
+			bool remove(const b120& id);
+			bool contains(const b120& id) const;
+
+			// Drops the transactions included in a connected block along with those conflicting with them.
+			void removeForBlock(const Block& b);
+			void removeForMasterBlock(MasterBlock& mb);
+
+			// Once a MasterBlock is disconnected, drops the transactions spending the outputs it created and takes
+			// its transactions back in, those which are no longer valid being left out.
+			void restoreForMasterBlock(MasterBlock& mb, const UtxoUndo& undo);
+
+			// Highest fee density first, within a total serialized size of maxSize. An entry which does not fit in
+			// what is left is skipped and the scan goes on, so smaller entries of a lower density may fill the rest.
+			void getTransactionsForBlock(size_t maxSize, vector<TransactionVariant>& transactions) const;
+
+			size_t size() const;
+			size_t getUsage() const;
+			void clear();
+
+		private: // METHODS
+
+			void erase(const Entry& e);
+			void evict();
+
+		};
+	}
+}
\ No newline at end of file
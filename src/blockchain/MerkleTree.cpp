@@ -0,0 +1,130 @@
+
+#include <stdexcept>
+#include <cstring>
+
+#include "MerkleTree.h"
+#include "utils/utils.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		MerkleTree::MerkleTree() {
+			_threadCount = ecrp::getProcessorCount();
+		}
+
+		MerkleTree::~MerkleTree() {
+		}
+
+		void MerkleTree::setThreadCount(uint32_t threadCount) {
+			_threadCount = std::max<uint32_t>(1, threadCount);
+		}
+
+		void MerkleTree::build(const vector<b256>& leaves) {
+			_levels.assign(1, leaves);
+			buildLevels();
+		}
+
+		void MerkleTree::build(const vector<TransactionVariant>& transactions) {
+			_levels.assign(1, vector<b256>(transactions.size()));
+			vector<b256>& leaves = _levels[0];
+
+			parallelFor(transactions.size(), [&](size_t begin, size_t end) {
+				vector<byte> buffer;
+				for (size_t i = begin; i < end; ++i) {
+					leaves[i] = hashTransaction(transactions[i], buffer);
+				}
+			});
+
+			buildLevels();
+		}
+
+		void MerkleTree::append(const b256& leaf) {
+			if (_levels.empty()) {
+				_levels.resize(1);
+			}
+			_levels[0].push_back(leaf);
+
+			// only the last node of each level depends on the new leaf
+			size_t i = _levels[0].size() - 1;
+			for (size_t l = 0; _levels[l].size() > 1; ++l) {
+				if (l + 1 == _levels.size()) {
+					_levels.resize(l + 2);
+				}
+				vector<b256>& level = _levels[l];
+				vector<b256>& parents = _levels[l + 1];
+
+				size_t parent = i / 2;
+				if (parents.size() <= parent) {
+					parents.resize(parent + 1);
+				}
+				parents[parent] = (i % 2 == 0) ? level[i] : hashNodes(level[i - 1], level[i]);
+				i = parent;
+			}
+		}
+
+		void MerkleTree::append(const TransactionVariant& t) {
+			vector<byte> buffer;
+			append(hashTransaction(t, buffer));
+		}
+
+		void MerkleTree::clear() {
+			_levels.clear();
+		}
+
+		size_t MerkleTree::getLeafCount() const {
+			return _levels.empty() ? 0 : _levels[0].size();
+		}
+
+		b256 MerkleTree::getRoot() const {
+			if (_levels.empty() || _levels.back().empty()) {
+				return b256();
+			}
+			return _levels.back()[0];
+		}
+
+		b256 MerkleTree::hashTransaction(const TransactionVariant& t, vector<byte>& buffer) {
+			buffer.resize(getTransactionSerializedSize(t));
+			be_ptr_ostream stream(buffer.data(), buffer.size());
+			serializeTransaction(t, stream);
+			return ecrp::crypto::sha256(buffer.data(), buffer.size());
+		}
+
+		b256 MerkleTree::hashNodes(const b256& left, const b256& right) {
+			byte buffer[2 * sizeof(b256)];
+			memcpy(buffer, left.b, sizeof(b256));
+			memcpy(buffer + sizeof(b256), right.b, sizeof(b256));
+			return ecrp::crypto::sha256(buffer, sizeof(buffer));
+		}
+
+		void MerkleTree::buildLevels() {
+			while (_levels.back().size() > 1) {
+				_levels.resize(_levels.size() + 1);
+				const vector<b256>& level = _levels[_levels.size() - 2];
+				vector<b256>& parents = _levels.back();
+				parents.resize((level.size() + 1) / 2);
+
+				parallelFor(parents.size(), [&](size_t begin, size_t end) {
+					// the two children of a node lie next to each other, so they are hashed in place, several nodes at a time
+					size_t pairedEnd = std::max(begin, std::min(end, level.size() / 2));
+					vector<HashInput> inputs(pairedEnd - begin);
+					for (size_t i = begin; i < pairedEnd; ++i) {
+						inputs[i - begin].pData = &level[2 * i];
+						inputs[i - begin].size = 2 * sizeof(b256);
+					}
+					ecrp::crypto::sha256_many(inputs.data(), parents.data() + begin, inputs.size());
+
+					for (size_t i = pairedEnd; i < end; ++i) {
+						parents[i] = level[2 * i];
+					}
+				});
+			}
+		}
+
+		void MerkleTree::parallelFor(size_t count, const std::function<void(size_t, size_t)>& f) const {
+			size_t threadCount = std::min((size_t)_threadCount, count / PARALLEL_THRESHOLD + 1);
+			ecrp::parallelFor(count, (uint32_t)threadCount, f);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+
+#pragma once
+
+#include <vector>
+#include <functional>
+
+using std::vector;
+
+#include "crypto/Crypto.h"
+#include "TransactionVariant.h"
+
+using ecrp::crypto::b256;
+using ecrp::crypto::HashInput;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Merkle tree over the transactions of a block, every level being kept so that appending a
+		// transaction only rehashes the last node of each level. A node is the sha256 of its two
+		// children concatenated, and the last node of an odd level is carried up unchanged rather
+		// than paired with itself. The nodes of a level are hashed several at a time with sha256_many, and
+		// a level only gets one more thread per PARALLEL_THRESHOLD nodes, so that in a typical block all of
+		// them are hashed by the calling thread and only the bottom levels of the largest ones start threads.
+		class MerkleTree {
+
+		private: // CONSTANTS
+
+			static const size_t PARALLEL_THRESHOLD = 4096;
+
+		private: // MEMBERS
+
+			vector<vector<b256> > _levels;
+			uint32_t _threadCount;
+
+		public: // CONSTRUCTORS
+
+			MerkleTree();
+
+			virtual ~MerkleTree();
+
+		public: // METHODS
+
+			void setThreadCount(uint32_t threadCount);
+
+			void build(const vector<b256>& leaves);
+			void build(const vector<TransactionVariant>& transactions);
+			void append(const b256& leaf);
+			void append(const TransactionVariant& t);
+			void clear();
+
+			size_t getLeafCount() const;
+			b256 getRoot() const;
+
+			static b256 hashTransaction(const TransactionVariant& t, vector<byte>& buffer);
+			static b256 hashNodes(const b256& left, const b256& right);
+
+		private: // METHODS
+
+			void buildLevels();
+			void parallelFor(size_t count, const std::function<void(size_t, size_t)>& f) const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+
+#include <stdexcept>
+#include <limits>
+#include <exception>
+
+#include <boost/thread.hpp>
+
+#include "Miner.h"
+#include "utils/utils.h"
+#include "utils/streams.h"
+
+using std::runtime_error;
+using ecrp::io::be_ptr_ostream;
+using ecrp::crypto::HashInput;
+using ecrp::crypto::Sha256Midstate;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		Miner::Miner() : _generation(0), _isRunning(false), _hashCount(0), _startTime(0), _endTime(0) {
+			_threadCount = ecrp::getProcessorCount();
+		}
+
+		Miner::~Miner() {
+			cancel();
+		}
+
+		void Miner::setThreadCount(uint32_t threadCount) {
+			_threadCount = std::max<uint32_t>(1, threadCount);
+		}
+
+		bool Miner::mine(MasterBlock& mb, uint64_t generation) {
+			byte header[MasterBlock::HEADER_SIZE];
+			be_ptr_ostream stream(header, sizeof(header));
+			mb.serializeHeader(stream);
+
+			const size_t prefixSize = sizeof(header) - sizeof(uint64_t);
+			const uint32_t target = mb.getTarget();
+
+			// the first block of the header does not hold the nonce, so it is only compressed once
+			Sha256Midstate midstate;
+			ecrp::crypto::sha256_midstate(header, prefixSize, midstate);
+			const byte* suffix = header + midstate.size;
+			const size_t suffixSize = sizeof(header) - (size_t)midstate.size;
+			const size_t noncePosition = prefixSize - (size_t)midstate.size;
+
+			_hashCount = 0;
+			_startTime = ecrp::getTimestampUTC();
+			_endTime = 0;
+			_isRunning = true;
+
+			std::atomic<bool> isFound(false);
+			std::atomic<bool> isFailed(false);
+			uint64_t foundNonce = 0;
+			std::exception_ptr error;
+			boost::mutex errorMutex;
+
+			// the nonce space is split in one contiguous range per thread
+			const uint64_t maxNonce = std::numeric_limits<uint64_t>::max();
+			const uint64_t span = maxNonce / _threadCount;
+			const uint32_t threadCount = _threadCount;
+
+			auto worker = [&](size_t k) {
+				uint64_t begin = k * span;
+				uint64_t end = (k + 1 == threadCount) ? maxNonce : begin + span;
+				try {
+					// every worker has its own candidate slots, which only differ by their nonce
+					vector<byte> candidates(HASH_BATCH_SIZE * suffixSize);
+					vector<HashInput> inputs(HASH_BATCH_SIZE);
+					vector<b256> hashes(HASH_BATCH_SIZE);
+					for (size_t slot = 0; slot < HASH_BATCH_SIZE; ++slot) {
+						memcpy(&candidates[slot * suffixSize], suffix, noncePosition);
+						inputs[slot].pData = &candidates[slot * suffixSize];
+						inputs[slot].size = suffixSize;
+					}
+
+					for (uint64_t batch = begin; batch < end && _generation == generation && !isFound && !isFailed; ) {
+						uint64_t batchEnd = (end - batch > NONCE_BATCH_SIZE) ? batch + NONCE_BATCH_SIZE : end;
+						uint64_t n = batch;
+						while (n < batchEnd) {
+							size_t count = (size_t)std::min<uint64_t>(HASH_BATCH_SIZE, batchEnd - n);
+							for (size_t slot = 0; slot < count; ++slot) {
+								byte* nonce = &candidates[slot * suffixSize + noncePosition];
+								for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+									nonce[i] = (byte)((n + slot) >> (8 * (sizeof(uint64_t) - 1 - i)));
+								}
+							}
+							ecrp::crypto::sha256_many(midstate, inputs.data(), hashes.data(), count);
+
+							size_t hit = 0;
+							while (hit < count && !checkProofOfWork(hashes[hit], target)) {
+								++hit;
+							}
+							if (hit < count) {
+								bool expected = false;
+								if (isFound.compare_exchange_strong(expected, true)) {
+									foundNonce = n + hit;
+								}
+								n += hit + 1;
+								break;
+							}
+							n += count;
+						}
+						_hashCount += n - batch;
+						batch = batchEnd;
+					}
+				} catch (...) {
+					boost::lock_guard<boost::mutex> lock(errorMutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+					isFailed = true;
+				}
+			};
+
+			// The workers only stop on a find or a cancellation, so they get threads of their own rather than
+			// holding the shared pool the validation and loading work runs on. The calling thread takes range 0.
+			boost::thread_group threads;
+			try {
+				for (uint32_t k = 1; k < threadCount; ++k) {
+					threads.create_thread([&worker, k]() { worker(k); });
+				}
+			} catch (...) {
+				isFailed = true;
+				threads.join_all();
+				_endTime = ecrp::getTimestampUTC();
+				_isRunning = false;
+				throw;
+			}
+			worker(0);
+			threads.join_all();
+
+			_endTime = ecrp::getTimestampUTC();
+			_isRunning = false;
+
+			if (error) {
+				std::rethrow_exception(error);
+			}
+
+			if (isFound) {
+				mb.setNonce(foundNonce);
+			}
+			return isFound;
+		}
+
+		void Miner::cancel() {
+			++_generation;
+		}
+
+		uint64_t Miner::getGeneration() const {
+			return _generation;
+		}
+
+		uint64_t Miner::getHashCount() const {
+			return _hashCount;
+		}
+
+		double Miner::getHashRate() const {
+			uint64_t end = _isRunning ? ecrp::getTimestampUTC() : (uint64_t)_endTime;
+			if (_startTime == 0 || end <= _startTime) {
+				return 0.0;
+			}
+			return 1000.0 * _hashCount / (end - _startTime); // the timestamps being in ms
+		}
+
+		bool Miner::checkProofOfWork(const b256& hash, uint32_t target) {
+			if (target > 8 * sizeof(hash.b)) {
+				return false;
+			}
+
+			uint32_t fullBytes = target / 8;
+			for (uint32_t i = 0; i < fullBytes; ++i) {
+				if (hash.b[i] != 0) {
+					return false;
+				}
+			}
+
+			uint32_t remainingBits = target % 8;
+			return remainingBits == 0 || (hash.b[fullBytes] >> (8 - remainingBits)) == 0;
+		}
+
+		bool Miner::checkProofOfWork(const MasterBlock& mb) {
+			return checkProofOfWork(mb.getHash(), mb.getTarget());
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include <atomic>
+
+#include "crypto/Crypto.h"
+#include "MasterBlock.h"
+
+using ecrp::crypto::b256;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Proof-of-work nonce search. The target of a MasterBlock is the number of leading zero bits its
+		// header hash must have. The first 64-byte block of the header does not hold the nonce, so its
+		// compression is done once and every attempt only compresses the last block, from that midstate.
+		// The rest of the header is copied once per candidate slot and only its nonce is rewritten per
+		// attempt, the candidates of a slot batch being hashed together by sha256_many. The nonce space is
+		// split in one contiguous range per thread.
+		class Miner {
+
+		private: // CONSTANTS
+
+			// Attempts made between two checks of the cancellation and two updates of the hash count.
+			static const uint64_t NONCE_BATCH_SIZE = 4096;
+
+			// Candidates hashed by a single sha256_many call, a divisor of NONCE_BATCH_SIZE.
+			static const size_t HASH_BATCH_SIZE = 64;
+
+		private: // MEMBERS
+
+			uint32_t _threadCount;
+			std::atomic<uint64_t> _generation;
+			std::atomic<bool> _isRunning;
+			std::atomic<uint64_t> _hashCount;
+			std::atomic<uint64_t> _startTime;
+			std::atomic<uint64_t> _endTime;
+
+		public: // CONSTRUCTORS
+
+			Miner();
+
+			virtual ~Miner();
+
+		public: // METHODS
+
+			void setThreadCount(uint32_t threadCount);
+
+			// Blocks until a valid nonce is found, in which case it is set on the MasterBlock, or until the
+			// search is cancelled or the nonce space exhausted, in which case false is returned.
+			// The generation is the one read before the MasterBlock was built (see getGeneration()): a search
+			// cancelled in between returns false right away instead of running for a stale tip.
+			bool mine(MasterBlock& mb, uint64_t generation);
+
+			// Stops the search in progress and any search of an earlier generation, e.g. when a new tip arrives.
+			// Can be called from any thread.
+			void cancel();
+			uint64_t getGeneration() const;
+
+			// Statistics of the search in progress, or of the last one.
+			uint64_t getHashCount() const;
+			double getHashRate() const;
+
+			static bool checkProofOfWork(const b256& hash, uint32_t target);
+			static bool checkProofOfWork(const MasterBlock& mb);
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,262 @@
+
+#include <stdexcept>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "RecordLog.h"
+#include "utils/streams.h"
+#include "utils/utils.h"
+
+using std::runtime_error;
+using boost::interprocess::file_mapping;
+using boost::interprocess::mapped_region;
+using boost::interprocess::read_only;
+using ecrp::io::be_file_istream;
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		RecordLog::RecordLog(const string& filename) {
+			_filename = filename;
+			_file = NULL;
+			_size = 0;
+		}
+
+		RecordLog::~RecordLog() {
+			close();
+		}
+
+		void RecordLog::open() {
+			if (_file) {
+				return;
+			}
+
+			_records.clear();
+			_size = 0;
+
+			if (boost::filesystem::exists(_filename)) {
+				be_file_istream fs(_filename.c_str());
+				if (!fs.is_open()) {
+					throw runtime_error("Unable to open the record log '" + _filename + "'.");
+				}
+
+				// only the length prefix and the id of each record are read
+				uint64_t size = fs._file_length();
+				while (_size + sizeof(uint32_t) + sizeof(uint32_t) <= size) {
+					Record record;
+					fs.seekg((int64_t)_size);
+					fs >> record.length;
+					fs >> record.id;
+					record.offset = _size + sizeof(record.length);
+					if (record.length < sizeof(record.id) || record.offset + record.length > size) {
+						break;
+					}
+
+					_records.push_back(record);
+					_size = record.offset + record.length;
+				}
+
+				if (_size < size) {
+					boost::filesystem::resize_file(_filename, _size);
+				}
+			}
+
+			_file = std::fopen(_filename.c_str(), "ab");
+			if (_file == NULL) {
+				throw runtime_error("Unable to open the record log '" + _filename + "' for appending.");
+			}
+		}
+
+		void RecordLog::close() {
+			if (!_file) {
+				return;
+			}
+
+			std::fclose(_file);
+			_file = NULL;
+		}
+
+		void RecordLog::sync() {
+			if (_file && !ecrp::syncFile(_file)) {
+				throw runtime_error("Syncing the record log '" + _filename + "' failed.");
+			}
+		}
+
+		void RecordLog::appendRecord(uint32_t id, const vector<byte>& payload) {
+			if (!_file) {
+				throw runtime_error("The record log '" + _filename + "' is not open.");
+			}
+
+			uint32_t length = (uint32_t)(sizeof(id) + payload.size());
+			byte header[sizeof(length) + sizeof(id)];
+			be_ptr_ostream s(header, sizeof(header));
+			s << length;
+			s << id;
+
+			if (std::fwrite(header, sizeof(header), 1, _file) != 1 || (!payload.empty() && std::fwrite(payload.data(), payload.size(), 1, _file) != 1)
+				|| std::fflush(_file) != 0) {
+				// Part of the record may have reached the file, which is cut back so that the next record goes where
+				// this one began. The stream is closed before the cut, so that none of its buffered bytes land past it.
+				std::fclose(_file);
+				_file = NULL;
+				try {
+					boost::filesystem::resize_file(_filename, _size);
+					_file = std::fopen(_filename.c_str(), "ab");
+				} catch (...) {
+					// the log stays closed
+				}
+				throw runtime_error("Writing to the record log '" + _filename + "' failed.");
+			}
+
+			Record record;
+			record.id = id;
+			record.offset = _size + sizeof(length);
+			record.length = length;
+			_records.push_back(record);
+			_size = record.offset + length;
+		}
+
+		bool RecordLog::readRecord(uint32_t id, vector<byte>& payload) const {
+			size_t i = findRecord(id);
+			if (i == _records.size()) {
+				return false;
+			}
+
+			payload.resize(_records[i].length - sizeof(id));
+			if (!payload.empty()) {
+				be_file_istream fs(_filename.c_str());
+				if (!fs.is_open()) {
+					throw runtime_error("Unable to open the record log '" + _filename + "'.");
+				}
+				fs.seekg((int64_t)(_records[i].offset + sizeof(id)));
+				fs.read(payload);
+			}
+			return true;
+		}
+
+		void RecordLog::readRecords(const std::function<void(uint32_t, be_ptr_istream&)>& f) const {
+			if (_records.empty()) {
+				return;
+			}
+
+			// the records are read straight from a mapping, so a scan costs no heap buffer whatever the size of the file
+			file_mapping file(_filename.c_str(), read_only);
+			mapped_region region(file, read_only, 0, (size_t)_size);
+			const byte* data = static_cast<const byte*>(region.get_address());
+
+			for (size_t i = 0; i < _records.size(); ++i) {
+				size_t offset = (size_t)_records[i].offset + sizeof(uint32_t);
+				be_ptr_istream s(data + offset, _records[i].length - sizeof(uint32_t));
+				f(_records[i].id, s);
+			}
+		}
+
+		bool RecordLog::contains(uint32_t id) const {
+			return findRecord(id) != _records.size();
+		}
+
+		size_t RecordLog::size() const {
+			return _records.size();
+		}
+
+		bool RecordLog::getLastId(uint32_t& id) const {
+			if (_records.empty()) {
+				return false;
+			}
+			id = _records.back().id;
+			return true;
+		}
+
+		void RecordLog::clear() {
+			truncate(0);
+		}
+
+		void RecordLog::removeLast(uint32_t id) {
+			if (!_records.empty() && _records.back().id == id) {
+				truncate(_records.size() - 1);
+			}
+		}
+
+		void RecordLog::truncateAfter(uint32_t id) {
+			size_t count = _records.size();
+			while (count > 0 && _records[count - 1].id > id) {
+				--count;
+			}
+			truncate(count);
+		}
+
+		void RecordLog::removeBefore(uint32_t id) {
+			size_t count = 0;
+			while (count < _records.size() && _records[count].id < id) {
+				++count;
+			}
+			if (count == 0) {
+				return;
+			}
+
+			// the records kept are copied aside and the copy renamed over the log, so that a crash leaves either of them whole
+			uint64_t begin = _records[count].offset - sizeof(uint32_t);
+			if (count == _records.size()) {
+				begin = _size;
+			}
+
+			vector<byte> buffer((size_t)(_size - begin));
+			if (!buffer.empty()) {
+				be_file_istream fs(_filename.c_str());
+				if (!fs.is_open()) {
+					throw runtime_error("Unable to open the record log '" + _filename + "'.");
+				}
+				fs.seekg((int64_t)begin);
+				fs.read(buffer);
+			}
+
+			string tempFilename = _filename + ".tmp";
+			std::FILE* file = std::fopen(tempFilename.c_str(), "wb");
+			if (file == NULL) {
+				throw runtime_error("Unable to create the record log '" + tempFilename + "'.");
+			}
+			bool isWritten = (buffer.empty() || std::fwrite(buffer.data(), buffer.size(), 1, file) == 1) && ecrp::syncFile(file);
+			std::fclose(file);
+			if (!isWritten) {
+				boost::filesystem::remove(tempFilename);
+				throw runtime_error("Writing the record log '" + tempFilename + "' failed.");
+			}
+
+			close();
+			boost::filesystem::rename(tempFilename, _filename);
+			open();
+		}
+
+		size_t RecordLog::findRecord(uint32_t id) const {
+			// records are in chain order, so their ids are growing
+			auto i = std::lower_bound(_records.begin(), _records.end(), id, [](const Record& r, uint32_t id) {
+				return r.id < id;
+			});
+			if (i != _records.end() && i->id == id) {
+				return i - _records.begin();
+			}
+			return _records.size();
+		}
+
+		void RecordLog::truncate(size_t count) {
+			if (count >= _records.size()) {
+				return;
+			}
+
+			_size = _records[count].offset - sizeof(uint32_t);
+			_records.resize(count);
+
+			if (_file) {
+				std::fflush(_file);
+			}
+			boost::filesystem::resize_file(_filename, _size);
+		}
+	}
+}
\ No newline at end of file
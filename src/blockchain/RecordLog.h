@@ -0,0 +1,86 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <functional>
+
+using std::string;
+using std::vector;
+
+#include "utils/byte.h"
+#include "utils/streams.h"
+
+using ecrp::io::be_ptr_istream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Append-only file of records kept alongside the chain, one per MasterBlock and in chain order. A record
+		// is a length prefix followed by the MasterBlock id and a payload. Since the records can be rebuilt
+		// from the chain, they are flushed but only synced on demand, and the ones of the MasterBlocks lost in
+		// a crash are dropped when the chain is loaded.
+		class RecordLog {
+
+		private: // TYPES
+
+			struct Record {
+				uint32_t id;
+				uint64_t offset; // position of the record payload, right after its length prefix
+				uint32_t length;
+			};
+
+		private: // MEMBERS
+
+			string _filename;
+			std::FILE* _file;
+			vector<Record> _records;
+			uint64_t _size;
+
+		public: // CONSTRUCTORS
+
+			RecordLog(const string& filename);
+
+			virtual ~RecordLog();
+
+		public: // METHODS
+
+			// A torn trailing record left by a crash is cut off, as is anything from a record too short for its id.
+			void open();
+			void close();
+			void sync();
+
+			bool contains(uint32_t id) const;
+			size_t size() const;
+			bool getLastId(uint32_t& id) const;
+
+			void clear();
+
+			// Drops the last record if it is the one of the given MasterBlock.
+			void removeLast(uint32_t id);
+
+			// Drops the records of the MasterBlocks after the given one.
+			void truncateAfter(uint32_t id);
+
+			// Drops the records of the MasterBlocks before the given one, rewriting the file.
+			void removeBefore(uint32_t id);
+
+		protected: // METHODS
+
+			void appendRecord(uint32_t id, const vector<byte>& payload);
+			bool readRecord(uint32_t id, vector<byte>& payload) const;
+
+			// Maps the whole file and calls f on the payload of every record, in chain order.
+			void readRecords(const std::function<void(uint32_t, be_ptr_istream&)>& f) const;
+
+		private: // METHODS
+
+			size_t findRecord(uint32_t id) const;
+			void truncate(size_t count);
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,228 @@
+
+#include <stdexcept>
+#include <cstdio>
+
+#include <boost/filesystem.hpp>
+
+#include "SegmentManifest.h"
+#include "utils/streams.h"
+#include "utils/utils.h"
+
+using std::runtime_error;
+using ecrp::io::be_file_istream;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		SegmentManifest::SegmentManifest(const string& filename) {
+			_filename = filename;
+		}
+
+		SegmentManifest::~SegmentManifest() {
+		}
+
+		void SegmentManifest::load() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			_segments.clear();
+
+			if (!boost::filesystem::exists(_filename)) {
+				for (uint32_t n = 0; boost::filesystem::exists(getSegmentFilename(n)); ++n) {
+					SegmentInfo info;
+					info.number = n;
+					info.size = boost::filesystem::file_size(getSegmentFilename(n));
+					info.recordCount = 0;
+					info.firstId = 0;
+					info.lastId = 0;
+					_segments.push_back(info);
+				}
+				return;
+			}
+
+			be_file_istream fs(_filename.c_str());
+			if (!fs.is_open()) {
+				throw runtime_error("Unable to open the segment manifest '" + _filename + "'.");
+			}
+
+			uint16_t version;
+			uint32_t segmentCount;
+			fs >> version;
+			fs >> segmentCount;
+
+			if (version != CURRENT_VERSION) {
+				throw runtime_error("Incompatible segment manifest version '" + std::to_string(version) + "'.");
+			}
+
+			for (uint32_t i = 0; i < segmentCount; ++i) {
+				SegmentInfo info;
+				fs >> info.number;
+				fs >> info.size;
+				fs >> info.recordCount;
+				fs >> info.firstId;
+				fs >> info.lastId;
+				_segments.push_back(info);
+			}
+		}
+
+		void SegmentManifest::save() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			saveUnlocked();
+		}
+
+		void SegmentManifest::saveUnlocked() const {
+			size_t entrySize = sizeof(uint32_t) + sizeof(uint64_t) + 3 * sizeof(uint32_t);
+			vector<byte> buffer(sizeof(uint16_t) + sizeof(uint32_t) + _segments.size() * entrySize);
+			be_ptr_ostream s(buffer.data(), buffer.size());
+			s << (uint16_t)CURRENT_VERSION;
+			s << (uint32_t)_segments.size();
+			for (size_t i = 0; i < _segments.size(); ++i) {
+				s << _segments[i].number;
+				s << _segments[i].size;
+				s << _segments[i].recordCount;
+				s << _segments[i].firstId;
+				s << _segments[i].lastId;
+			}
+
+			// written aside and renamed over the previous manifest, so that a crash leaves either of them whole
+			string tempFilename = _filename + ".tmp";
+			std::FILE* file = std::fopen(tempFilename.c_str(), "wb");
+			if (file == NULL) {
+				throw runtime_error("Unable to create the segment manifest '" + tempFilename + "'.");
+			}
+			bool isWritten = std::fwrite(buffer.data(), buffer.size(), 1, file) == 1 && ecrp::syncFile(file);
+			std::fclose(file);
+			if (!isWritten) {
+				boost::filesystem::remove(tempFilename);
+				throw runtime_error("Writing the segment manifest '" + tempFilename + "' failed.");
+			}
+			boost::filesystem::rename(tempFilename, _filename);
+		}
+
+		size_t SegmentManifest::getSegmentCount() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _segments.size();
+		}
+
+		SegmentInfo SegmentManifest::getSegment(size_t i) const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _segments.at(i);
+		}
+
+		bool SegmentManifest::findSegment(uint32_t number, SegmentInfo& info) const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (_segments.empty() || number < _segments.front().number || number > _segments.back().number) {
+				return false;
+			}
+			info = _segments[number - _segments.front().number];
+			return true;
+		}
+
+		vector<SegmentInfo> SegmentManifest::getSegments() const {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			return _segments;
+		}
+
+		uint32_t SegmentManifest::addSegment() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			SegmentInfo info;
+			info.number = _segments.empty() ? 0 : _segments.back().number + 1;
+			info.size = 0;
+			info.recordCount = 0;
+			info.firstId = 0;
+			info.lastId = 0;
+			_segments.push_back(info);
+
+			saveUnlocked();
+			return info.number;
+		}
+
+		void SegmentManifest::clearRecords() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			for (size_t i = 0; i < _segments.size(); ++i) {
+				_segments[i].size = 0;
+				_segments[i].recordCount = 0;
+				_segments[i].firstId = 0;
+				_segments[i].lastId = 0;
+			}
+		}
+
+		bool SegmentManifest::addRecord(uint32_t number, uint32_t id, uint64_t end) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (_segments.empty() || number < _segments.front().number || number > _segments.back().number) {
+				return false; // pruned
+			}
+
+			SegmentInfo& info = _segments[number - _segments.front().number];
+			if (info.recordCount == 0) {
+				info.firstId = id;
+			}
+			info.lastId = id;
+			info.size = end;
+			++info.recordCount;
+			return true;
+		}
+
+		void SegmentManifest::removeLastRecord(uint32_t number, uint32_t previousId, uint64_t end) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (_segments.empty() || number < _segments.front().number || number > _segments.back().number) {
+				return;
+			}
+
+			SegmentInfo& info = _segments[number - _segments.front().number];
+			if (info.recordCount > 0) {
+				--info.recordCount;
+			}
+			info.size = end;
+			info.lastId = info.recordCount > 0 ? previousId : 0;
+			if (info.recordCount == 0) {
+				info.firstId = 0;
+			}
+		}
+
+		void SegmentManifest::pruneBefore(uint32_t number) {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			size_t count = 0;
+			while (count < _segments.size() && _segments[count].number < number) {
+				++count;
+			}
+			if (count == 0) {
+				return;
+			}
+
+			vector<SegmentInfo> pruned(_segments.begin(), _segments.begin() + count);
+			_segments.erase(_segments.begin(), _segments.begin() + count);
+
+			// the manifest is saved first, so that a crash never leaves it listing a deleted segment
+			saveUnlocked();
+			for (size_t i = 0; i < pruned.size(); ++i) {
+				boost::filesystem::remove(getSegmentFilename(pruned[i].number));
+			}
+		}
+
+		void SegmentManifest::removeLastSegment() {
+			boost::lock_guard<boost::mutex> lock(_mutex);
+
+			if (_segments.empty()) {
+				return;
+			}
+
+			uint32_t number = _segments.back().number;
+			_segments.pop_back();
+
+			// the manifest is saved first, so that a crash never leaves it listing a deleted segment
+			saveUnlocked();
+			boost::filesystem::remove(getSegmentFilename(number));
+		}
+
+		string SegmentManifest::getSegmentFilename(uint32_t number) {
+			char filename[32];
+			snprintf(filename, sizeof(filename), "blk%05u.dat", number);
+			return filename;
+		}
+	}
+}
\ No newline at end of file
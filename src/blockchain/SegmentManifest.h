@@ -0,0 +1,83 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+using std::string;
+using std::vector;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		struct SegmentInfo {
+			uint32_t number;
+			uint64_t size;
+			uint32_t recordCount;
+			uint32_t firstId;
+			uint32_t lastId;
+		};
+
+		// Lists the segment files (blk00000.dat, blk00001.dat, ...) the chain is stored in, oldest first.
+		// Each segment holds whole length-prefixed MasterBlock records and is sealed once the next record
+		// would make it exceed the segment size. Only the last segment is ever appended to, so its figures
+		// are only exact once it is sealed. Old segments can be pruned or moved elsewhere once they are
+		// covered by a UTXO snapshot.
+		class SegmentManifest {
+
+		private: // CONSTANTS
+
+			static const uint16_t CURRENT_VERSION = 1;
+
+		private: // MEMBERS
+
+			string _filename;
+			vector<SegmentInfo> _segments;
+			mutable boost::mutex _mutex;
+
+		public: // CONSTRUCTORS
+
+			SegmentManifest(const string& filename);
+
+			virtual ~SegmentManifest();
+
+		public: // METHODS
+
+			// Without a manifest, the consecutive segment files found from blk00000.dat on are listed.
+			void load();
+			void save() const;
+
+			size_t getSegmentCount() const;
+			SegmentInfo getSegment(size_t i) const;
+			bool findSegment(uint32_t number, SegmentInfo& info) const;
+			vector<SegmentInfo> getSegments() const;
+
+			// Opens a new segment after the last one, which is thereby sealed, and saves the manifest.
+			uint32_t addSegment();
+
+			// The figures of the segments are rebuilt from the MasterBlock index, records being added in chain order.
+			void clearRecords();
+			bool addRecord(uint32_t number, uint32_t id, uint64_t end);
+
+			// Forgets the last record of the segment, the previous one (if any) ending at end and having the given id.
+			void removeLastRecord(uint32_t number, uint32_t previousId, uint64_t end);
+
+			// Forgets the oldest segments up to the given one (excluded) and deletes their files.
+			void pruneBefore(uint32_t number);
+
+			// Forgets the last segment, which must hold no record anymore, and deletes its file.
+			void removeLastSegment();
+
+			static string getSegmentFilename(uint32_t number);
+
+		private: // METHODS
+
+			void saveUnlocked() const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+
+#include <cstring>
+#include <algorithm>
+
+#include "SignatureCache.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		static const size_t DEFAULT_MAX_SIZE = 256 * 1024;
+
+		size_t SignatureCache::KeyHash::operator()(const b256& key) const {
+			// keys are hashes, any of their bytes will do
+			size_t h;
+			memcpy(&h, key.b + sizeof(size_t), sizeof(h));
+			return h;
+		}
+
+		bool SignatureCache::KeyEqual::operator()(const b256& a, const b256& b) const {
+			return memcmp(a.b, b.b, sizeof(a.b)) == 0;
+		}
+
+		SignatureCache::SignatureCache() {
+			setMaxSize(DEFAULT_MAX_SIZE);
+		}
+
+		SignatureCache::~SignatureCache() {
+		}
+
+		void SignatureCache::setMaxSize(size_t maxSize) {
+			_maxShardSize = std::max<size_t>(1, maxSize / SHARD_COUNT);
+		}
+
+		b256 SignatureCache::getKey(const b256& message, const TransactionInput& input) {
+			byte buffer[sizeof(message) + sizeof(input.signatureR) + sizeof(input.signatureS) + sizeof(input.publicKey)];
+			byte* p = buffer;
+			memcpy(p, &message, sizeof(message));
+			p += sizeof(message);
+			memcpy(p, &input.signatureR, sizeof(input.signatureR));
+			p += sizeof(input.signatureR);
+			memcpy(p, &input.signatureS, sizeof(input.signatureS));
+			p += sizeof(input.signatureS);
+			memcpy(p, &input.publicKey, sizeof(input.publicKey));
+
+			return ecrp::crypto::sha256(buffer, sizeof(buffer));
+		}
+
+		bool SignatureCache::contains(const b256& key, bool erase) {
+			Shard& s = getShard(key);
+			boost::lock_guard<boost::mutex> lock(s.mutex);
+
+			auto i = s.keys.find(key);
+			if (i == s.keys.end()) {
+				return false;
+			}
+			if (erase) {
+				s.keys.erase(i);
+			}
+			return true;
+		}
+
+		void SignatureCache::insert(const b256& key) {
+			Shard& s = getShard(key);
+			boost::lock_guard<boost::mutex> lock(s.mutex);
+
+			uint64_t sequence = s.nextSequence;
+			if (!s.keys.insert(std::make_pair(key, sequence)).second) {
+				return;
+			}
+			++s.nextSequence;
+			s.order.push_back(std::make_pair(key, sequence));
+
+			size_t maxShardSize = _maxShardSize;
+			while (s.keys.size() > maxShardSize) {
+				auto i = s.keys.find(s.order.front().first);
+				if (i != s.keys.end() && i->second == s.order.front().second) {
+					s.keys.erase(i);
+				}
+				s.order.pop_front();
+			}
+
+			// the stale entries left by erased keys are dropped once they make up half of the order
+			if (s.order.size() > 2 * maxShardSize) {
+				deque<pair<b256, uint64_t> > order;
+				for (auto j = s.order.begin(); j != s.order.end(); ++j) {
+					auto i = s.keys.find(j->first);
+					if (i != s.keys.end() && i->second == j->second) {
+						order.push_back(*j);
+					}
+				}
+				s.order.swap(order);
+			}
+		}
+
+		size_t SignatureCache::size() {
+			size_t result = 0;
+			for (size_t i = 0; i < SHARD_COUNT; ++i) {
+				boost::lock_guard<boost::mutex> lock(_shards[i].mutex);
+				result += _shards[i].keys.size();
+			}
+			return result;
+		}
+
+		void SignatureCache::clear() {
+			for (size_t i = 0; i < SHARD_COUNT; ++i) {
+				boost::lock_guard<boost::mutex> lock(_shards[i].mutex);
+				_shards[i].keys.clear();
+				_shards[i].order.clear();
+			}
+		}
+
+		SignatureCache::Shard& SignatureCache::getShard(const b256& key) {
+			return _shards[key.b[0] % SHARD_COUNT];
+		}
+	}
+}
\ No newline at end of file
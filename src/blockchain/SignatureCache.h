@@ -0,0 +1,87 @@
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <atomic>
+
+#include <boost/thread.hpp>
+
+using std::deque;
+using std::unordered_map;
+using std::pair;
+
+#include "crypto/Crypto.h"
+#include "transactions/TransactionInput.h"
+
+using ecrp::crypto::b256;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Bounded set of the signatures already found valid, so that a transaction verified on its admission to
+		// the mempool is not verified again when its block is connected. Entries are keyed by a hash of the signed
+		// message, the signature and the public key, and are spread over shards locked independently, so that the
+		// validation threads seldom wait for each other. Each shard forgets its oldest entries once full.
+		class SignatureCache {
+
+		private: // CONSTANTS
+
+			static const size_t SHARD_COUNT = 16;
+
+		private: // TYPES
+
+			struct KeyHash {
+				size_t operator()(const b256& key) const;
+			};
+
+			struct KeyEqual {
+				bool operator()(const b256& a, const b256& b) const;
+			};
+
+			// Every insertion gets a sequence number, kept with the key and in the order. An entry of the order whose
+			// number is not the one of its key anymore was erased, or inserted again since, and is skipped.
+			struct Shard {
+				boost::mutex mutex;
+				unordered_map<b256, uint64_t, KeyHash, KeyEqual> keys;
+				deque<pair<b256, uint64_t> > order;
+				uint64_t nextSequence;
+
+				Shard() : nextSequence(0) {}
+			};
+
+		private: // MEMBERS
+
+			Shard _shards[SHARD_COUNT];
+			std::atomic<size_t> _maxShardSize;
+
+		public: // CONSTRUCTORS
+
+			SignatureCache();
+
+			virtual ~SignatureCache();
+
+		public: // METHODS
+
+			void setMaxSize(size_t maxSize);
+
+			static b256 getKey(const b256& message, const TransactionInput& input);
+
+			// When erase is set, a key found is forgotten as well, which suits the transactions being connected
+			// since they will not be seen again.
+			bool contains(const b256& key, bool erase = false);
+			void insert(const b256& key);
+
+			size_t size();
+			void clear();
+
+		private: // METHODS
+
+			Shard& getShard(const b256& key);
+
+		};
+	}
+}
\ No newline at end of file
@@ -14,6 +14,7 @@ namespace ecrp {
 		}
 
 		Transaction::Transaction(uint8_t type) {
+			_version = CURRENT_VERSION;
 			_type = type;
 		}
 
@@ -28,5 +29,18 @@ namespace ecrp {
 				throw runtime_error("Incompatible ecrp::blockchain::Transaction version '" + std::to_string(_version) + "'.");
 			}
 		}
+
+		void Transaction::serialize(be_ptr_ostream& stream) const {
+			stream << (uint16_t)CURRENT_VERSION;
+			stream << _type;
+		}
+
+		size_t Transaction::serializedSize() const {
+			return sizeof(_version) + sizeof(_type);
+		}
+
+		uint8_t Transaction::getType() const {
+			return _type;
+		}
 	}
 }
\ No newline at end of file
@@ -5,12 +5,15 @@
 #include "crypto/Crypto.h"
 
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
 
 //----------------------------------------------------------------------
 
 namespace ecrp {
 	namespace blockchain {
 
+		// Base of the concrete transaction types, which are stored by value in a TransactionVariant
+		// and dispatched on their type byte, hence no virtual methods.
 		class Transaction {
 
 		protected: // CONSTANTS
@@ -28,11 +31,15 @@ namespace ecrp {
 			Transaction();
 			Transaction(uint8_t type);
 
-			virtual ~Transaction();
+			~Transaction();
 
 		public: // METHODS
 
-			virtual void deserialize(be_ptr_istream& stream);
+			void deserialize(be_ptr_istream& stream);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
+
+			uint8_t getType() const;
 
 		};
 	}
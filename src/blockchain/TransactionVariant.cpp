@@ -0,0 +1,132 @@
+
+#include <stdexcept>
+#include <cstring>
+
+using std::runtime_error;
+
+#include "TransactionVariant.h"
+#include "TransactionType.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		namespace {
+
+			class SerializeVisitor : public boost::static_visitor<> {
+
+			private: // MEMBERS
+
+				be_ptr_ostream& _stream;
+
+			public: // CONSTRUCTORS
+
+				SerializeVisitor(be_ptr_ostream& stream) : _stream(stream) {
+				}
+
+			public: // METHODS
+
+				template<typename T> void operator()(const T& t) const {
+					t.serialize(_stream);
+				}
+
+			};
+
+			class SerializedSizeVisitor : public boost::static_visitor<size_t> {
+
+			public: // METHODS
+
+				template<typename T> size_t operator()(const T& t) const {
+					return t.serializedSize();
+				}
+
+			};
+
+			class TypeVisitor : public boost::static_visitor<uint8_t> {
+
+			public: // METHODS
+
+				template<typename T> uint8_t operator()(const T& t) const {
+					return t.getType();
+				}
+
+			};
+
+			class OutputsVisitor : public boost::static_visitor<const TransactionOutputs&> {
+
+			public: // METHODS
+
+				template<typename T> const TransactionOutputs& operator()(const T& t) const {
+					return t.getOutputs();
+				}
+
+			};
+
+			template<typename T> void deserializeAs(be_ptr_istream& stream, vector<TransactionVariant>& transactions, Arena* arena) {
+				transactions.push_back(T());
+				boost::get<T>(transactions.back()).deserialize(stream, arena);
+			}
+		}
+
+		void deserializeTransaction(be_ptr_istream& stream, vector<TransactionVariant>& transactions, Arena* arena) {
+			// peek at the common header without consuming it, the concrete type reads it again
+			be_ptr_istream header = stream;
+			uint16_t version;
+			uint8_t type;
+			header >> version;
+			header >> type;
+
+			switch (type) {
+			case TransactionType::BASIC:
+				deserializeAs<BasicTransaction>(stream, transactions, arena);
+				break;
+			case TransactionType::FEE:
+				deserializeAs<FeeTransaction>(stream, transactions, arena);
+				break;
+			case TransactionType::REWARD:
+				deserializeAs<RewardTransaction>(stream, transactions, arena);
+				break;
+			default:
+				throw runtime_error("Unknown ecrp::blockchain::Transaction type '" + std::to_string(type) + "'.");
+			}
+		}
+
+		void serializeTransaction(const TransactionVariant& t, be_ptr_ostream& stream) {
+			boost::apply_visitor(SerializeVisitor(stream), t);
+		}
+
+		size_t getTransactionSerializedSize(const TransactionVariant& t) {
+			return boost::apply_visitor(SerializedSizeVisitor(), t);
+		}
+
+		uint8_t getTransactionType(const TransactionVariant& t) {
+			return boost::apply_visitor(TypeVisitor(), t);
+		}
+
+		const TransactionInput* getTransactionInput(const TransactionVariant& t) {
+			const BasicTransaction* bt = boost::get<BasicTransaction>(&t);
+			return bt ? &bt->getInput() : NULL;
+		}
+
+		const TransactionOutputs& getTransactionOutputs(const TransactionVariant& t) {
+			return boost::apply_visitor(OutputsVisitor(), t);
+		}
+
+		b120 getTransactionId(const TransactionVariant& t) {
+			vector<byte> buffer;
+			return getTransactionId(t, buffer);
+		}
+
+		b120 getTransactionId(const TransactionVariant& t, vector<byte>& buffer) {
+			buffer.resize(getTransactionSerializedSize(t));
+			be_ptr_ostream stream(buffer.data(), buffer.size());
+			serializeTransaction(t, stream);
+
+			b256 hash = ecrp::crypto::sha256(buffer.data(), buffer.size());
+			b120 id;
+			memcpy(id.b, hash.b, sizeof(id.b));
+			return id;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+#include <boost/variant.hpp>
+
+#include "utils/streams.h"
+#include "transactions/BasicTransaction.h"
+#include "transactions/FeeTransaction.h"
+#include "transactions/RewardTransaction.h"
+
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::crypto::b120;
+using ecrp::Arena;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Transactions are stored by value in their block; the concrete type is picked from the
+		// type byte at decoding time and resolved statically by the visitors below.
+		typedef boost::variant<BasicTransaction, FeeTransaction, RewardTransaction> TransactionVariant;
+
+		// Reads the next transaction of the stream, dispatching on its type byte, and appends it to the given vector.
+		// With an arena, the outputs of the transaction are decoded into it (see TransactionOutputs).
+		void deserializeTransaction(be_ptr_istream& stream, vector<TransactionVariant>& transactions, Arena* arena = NULL);
+
+		void serializeTransaction(const TransactionVariant& t, be_ptr_ostream& stream);
+		size_t getTransactionSerializedSize(const TransactionVariant& t);
+		uint8_t getTransactionType(const TransactionVariant& t);
+
+		// Returns the input of a basic transaction, NULL for the types which have none.
+		const TransactionInput* getTransactionInput(const TransactionVariant& t);
+		const TransactionOutputs& getTransactionOutputs(const TransactionVariant& t);
+
+		// The id of a transaction is the sha256 of its serialized form truncated to 120 bits, which is
+		// what TransactionInput::source refers to. The buffer is only scratch space and can be reused.
+		b120 getTransactionId(const TransactionVariant& t);
+		b120 getTransactionId(const TransactionVariant& t, vector<byte>& buffer);
+	}
+}
\ No newline at end of file
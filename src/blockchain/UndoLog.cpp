@@ -0,0 +1,62 @@
+
+#include "UndoLog.h"
+
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		UndoLog::UndoLog(const string& filename) : RecordLog(filename) {
+		}
+
+		UndoLog::~UndoLog() {
+		}
+
+		void UndoLog::append(uint32_t id, const UtxoUndo& undo) {
+			vector<byte> payload(sizeof(uint32_t) + undo.spent.size() * SPENT_ENTRY_SIZE + sizeof(uint32_t) + undo.created.size() * CREATED_ENTRY_SIZE);
+			be_ptr_ostream s(payload.data(), payload.size());
+			s << (uint32_t)undo.spent.size();
+			for (size_t i = 0; i < undo.spent.size(); ++i) {
+				s << undo.spent[i].outPoint.source;
+				s << undo.spent[i].outPoint.outputId;
+				undo.spent[i].output.serialize(s);
+			}
+			s << (uint32_t)undo.created.size();
+			for (size_t i = 0; i < undo.created.size(); ++i) {
+				s << undo.created[i].source;
+				s << undo.created[i].outputId;
+			}
+
+			appendRecord(id, payload);
+		}
+
+		bool UndoLog::read(uint32_t id, UtxoUndo& undo) const {
+			vector<byte> payload;
+			if (!readRecord(id, payload)) {
+				return false;
+			}
+
+			be_ptr_istream s(payload);
+			uint32_t count;
+
+			s >> count;
+			undo.spent.resize(count);
+			for (uint32_t k = 0; k < count; ++k) {
+				s >> undo.spent[k].outPoint.source;
+				s >> undo.spent[k].outPoint.outputId;
+				undo.spent[k].output.deserialize(s);
+			}
+
+			s >> count;
+			undo.created.resize(count);
+			for (uint32_t k = 0; k < count; ++k) {
+				s >> undo.created[k].source;
+				s >> undo.created[k].outputId;
+			}
+
+			return true;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include <string>
+
+using std::string;
+
+#include "RecordLog.h"
+#include "UtxoSet.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Persisted undo records of the connected MasterBlocks: the outputs each of them spent, with their
+		// content, and the outputs it created. Disconnecting the tip only reads its own record, so it costs
+		// time proportional to that MasterBlock and not to the chain.
+		class UndoLog : public RecordLog {
+
+		private: // CONSTANTS
+
+			static const size_t SPENT_ENTRY_SIZE = sizeof(b120) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(b120);
+			static const size_t CREATED_ENTRY_SIZE = sizeof(b120) + sizeof(uint16_t);
+
+		public: // CONSTRUCTORS
+
+			UndoLog(const string& filename);
+
+			virtual ~UndoLog();
+
+		public: // METHODS
+
+			void append(uint32_t id, const UtxoUndo& undo);
+			bool read(uint32_t id, UtxoUndo& undo) const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,363 @@
+
+#include <stdexcept>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+using std::runtime_error;
+using boost::interprocess::file_mapping;
+using boost::interprocess::mapped_region;
+using boost::interprocess::read_only;
+
+#include "UtxoSet.h"
+#include "TransactionVariant.h"
+#include "utils/streams.h"
+#include "utils/utils.h"
+
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		static const size_t NO_SLOT = (size_t)-1;
+
+		size_t OutPointHash::operator()(const OutPoint& o) const {
+			size_t h;
+			memcpy(&h, o.source.b, sizeof(h));
+			return h ^ ((size_t)o.outputId * 0x9E3779B97F4A7C15ULL);
+		}
+
+		bool OutPointEqual::operator()(const OutPoint& a, const OutPoint& b) const {
+			return a.outputId == b.outputId && memcmp(a.source.b, b.source.b, sizeof(a.source.b)) == 0;
+		}
+
+		UtxoSet::UtxoSet() {
+			_count = 0;
+			_slots.resize(MIN_CAPACITY);
+			_mask = MIN_CAPACITY - 1;
+		}
+
+		UtxoSet::~UtxoSet() {
+		}
+
+		void UtxoSet::reserve(size_t count) {
+			size_t capacity = _slots.size();
+			while (count * 100 > capacity * MAX_LOAD_PERCENT) {
+				capacity *= 2;
+			}
+			if (capacity > _slots.size()) {
+				rehash(capacity);
+			}
+		}
+
+		void UtxoSet::clear() {
+			_slots.assign(MIN_CAPACITY, Slot());
+			_mask = MIN_CAPACITY - 1;
+			_count = 0;
+		}
+
+		size_t UtxoSet::size() const {
+			return _count;
+		}
+
+		bool UtxoSet::find(const OutPoint& outPoint, TransactionOutput& output) const {
+			size_t i = findSlot(outPoint);
+			if (i == NO_SLOT) {
+				return false;
+			}
+			output.amount = _slots[i].amount;
+			output.address = _slots[i].address;
+			return true;
+		}
+
+		bool UtxoSet::insert(const OutPoint& outPoint, const TransactionOutput& output) {
+			if ((_count + 1) * 100 > _slots.size() * MAX_LOAD_PERCENT) {
+				rehash(_slots.size() * 2);
+			}
+
+			size_t i = hash(outPoint.source, outPoint.outputId) & _mask;
+			while (_slots[i].isUsed) {
+				if (_slots[i].outputId == outPoint.outputId && memcmp(_slots[i].source.b, outPoint.source.b, sizeof(outPoint.source.b)) == 0) {
+					return false;
+				}
+				i = (i + 1) & _mask;
+			}
+
+			Slot& s = _slots[i];
+			s.amount = output.amount;
+			s.source = outPoint.source;
+			s.address = output.address;
+			s.outputId = outPoint.outputId;
+			s.isUsed = true;
+			++_count;
+			return true;
+		}
+
+		bool UtxoSet::erase(const OutPoint& outPoint, TransactionOutput* output) {
+			size_t i = findSlot(outPoint);
+			if (i == NO_SLOT) {
+				return false;
+			}
+
+			if (output) {
+				output->amount = _slots[i].amount;
+				output->address = _slots[i].address;
+			}
+
+			// backward-shift deletion: every following entry of the cluster which may legally sit in the
+			// freed slot is moved back into it, so that probe sequences never cross an empty slot
+			size_t j = i;
+			for (;;) {
+				j = (j + 1) & _mask;
+				if (!_slots[j].isUsed) {
+					break;
+				}
+				size_t home = hash(_slots[j].source, _slots[j].outputId) & _mask;
+				if (((j - home) & _mask) >= ((j - i) & _mask)) {
+					_slots[i] = _slots[j];
+					i = j;
+				}
+			}
+			_slots[i].isUsed = false;
+			--_count;
+			return true;
+		}
+
+		void UtxoSet::applyBlock(const Block& b, UtxoUndo& undo) {
+			undo.spent.clear();
+			undo.created.clear();
+
+			vector<byte> buffer;
+			try {
+				applyTransactions(b, NULL, undo, buffer);
+			} catch (...) {
+				revert(undo);
+				undo.spent.clear();
+				undo.created.clear();
+				throw;
+			}
+		}
+
+		void UtxoSet::applyMasterBlock(MasterBlock& mb, const vector<b120>& transactionIds, UtxoUndo& undo) {
+			undo.spent.clear();
+			undo.created.clear();
+
+			vector<byte> buffer;
+			try {
+				size_t first = 0;
+				for (uint16_t i = 0; i < mb.getBlockCount(); ++i) {
+					const Block& b = *mb.getBlock(i);
+					if (first + b.getTransactionCount() > transactionIds.size()) {
+						throw runtime_error("Missing transaction ids for the ecrp::blockchain::MasterBlock '" + std::to_string(mb.getId()) + "'.");
+					}
+					applyTransactions(b, &transactionIds[first], undo, buffer);
+					first += b.getTransactionCount();
+				}
+			} catch (...) {
+				revert(undo);
+				undo.spent.clear();
+				undo.created.clear();
+				throw;
+			}
+		}
+
+		void UtxoSet::revert(const UtxoUndo& undo) {
+			// the spent outputs are restored first: an output both created and spent by the reverted
+			// change is then removed along with the other created ones
+			for (auto i = undo.spent.rbegin(); i != undo.spent.rend(); ++i) {
+				insert(i->outPoint, i->output);
+			}
+			for (auto i = undo.created.rbegin(); i != undo.created.rend(); ++i) {
+				erase(*i);
+			}
+		}
+
+		void UtxoSet::save(const string& filename, uint32_t masterBlockId) const {
+			string tempFilename = filename + ".tmp";
+
+			std::FILE* file = std::fopen(tempFilename.c_str(), "wb");
+			if (file == NULL) {
+				throw runtime_error("Unable to create the UTXO snapshot '" + tempFilename + "'.");
+			}
+
+			try {
+				vector<byte> buffer(std::max(SNAPSHOT_HEADER_SIZE, SNAPSHOT_BATCH_SIZE * SNAPSHOT_ENTRY_SIZE));
+				be_ptr_ostream header(buffer.data(), buffer.size());
+				header << (uint16_t)SNAPSHOT_VERSION;
+				header << masterBlockId;
+				header << (uint64_t)_count;
+				if (std::fwrite(buffer.data(), SNAPSHOT_HEADER_SIZE, 1, file) != 1) {
+					throw runtime_error("Writing the UTXO snapshot '" + tempFilename + "' failed.");
+				}
+
+				// entries are written in batches to keep the number of stdio calls low
+				size_t k = 0;
+				while (k < _slots.size()) {
+					be_ptr_ostream stream(buffer.data(), buffer.size());
+					for (size_t n = 0; n < SNAPSHOT_BATCH_SIZE && k < _slots.size(); ++k) {
+						const Slot& s = _slots[k];
+						if (s.isUsed) {
+							stream << s.source;
+							stream << s.outputId;
+							stream << s.amount;
+							stream << s.address;
+							++n;
+						}
+					}
+					size_t size = (size_t)stream.tellp();
+					if (size > 0 && std::fwrite(buffer.data(), size, 1, file) != 1) {
+						throw runtime_error("Writing the UTXO snapshot '" + tempFilename + "' failed.");
+					}
+				}
+
+				if (!ecrp::syncFile(file)) {
+					throw runtime_error("Syncing the UTXO snapshot '" + tempFilename + "' failed.");
+				}
+			} catch (...) {
+				std::fclose(file);
+				boost::filesystem::remove(tempFilename);
+				throw;
+			}
+
+			std::fclose(file);
+			boost::filesystem::rename(tempFilename, filename);
+		}
+
+		bool UtxoSet::load(const string& filename, uint32_t& masterBlockId) {
+			clear();
+
+			if (!boost::filesystem::exists(filename) || boost::filesystem::file_size(filename) < SNAPSHOT_HEADER_SIZE) {
+				return false;
+			}
+
+			file_mapping file(filename.c_str(), read_only);
+			mapped_region region(file, read_only);
+			be_ptr_istream stream((const byte*)region.get_address(), region.get_size());
+
+			uint16_t version;
+			uint64_t count;
+			stream >> version;
+			stream >> masterBlockId;
+			stream >> count;
+
+			size_t entriesSize = region.get_size() - SNAPSHOT_HEADER_SIZE;
+			if (version != SNAPSHOT_VERSION || entriesSize % SNAPSHOT_ENTRY_SIZE != 0 || count != entriesSize / SNAPSHOT_ENTRY_SIZE) {
+				return false;
+			}
+
+			reserve((size_t)count);
+
+			OutPoint outPoint;
+			TransactionOutput output;
+			for (uint64_t i = 0; i < count; ++i) {
+				stream >> outPoint.source;
+				stream >> outPoint.outputId;
+				output.deserialize(stream);
+				if (!insert(outPoint, output)) {
+					clear();
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		uint64_t UtxoSet::getBalance(const b120& address) const {
+			uint64_t balance = 0;
+			for (size_t i = 0; i < _slots.size(); ++i) {
+				if (_slots[i].isUsed && memcmp(_slots[i].address.b, address.b, sizeof(address.b)) == 0) {
+					balance += _slots[i].amount;
+				}
+			}
+			return balance;
+		}
+
+		void UtxoSet::getOutputsForAddress(const b120& address, vector<UnspentOutput>& outputs) const {
+			for (size_t i = 0; i < _slots.size(); ++i) {
+				if (_slots[i].isUsed && memcmp(_slots[i].address.b, address.b, sizeof(address.b)) == 0) {
+					UnspentOutput u;
+					u.outPoint.source = _slots[i].source;
+					u.outPoint.outputId = _slots[i].outputId;
+					u.output.amount = _slots[i].amount;
+					u.output.address = _slots[i].address;
+					outputs.push_back(u);
+				}
+			}
+		}
+
+		size_t UtxoSet::hash(const b120& source, uint16_t outputId) const {
+			// the source already is a truncated sha256, so its first bytes are uniformly distributed
+			// and only need to be mixed with the output id
+			uint64_t h;
+			memcpy(&h, source.b, sizeof(h));
+			h ^= (uint64_t)outputId * 0x9E3779B97F4A7C15ULL;
+			h ^= h >> 29;
+			return (size_t)h;
+		}
+
+		size_t UtxoSet::findSlot(const OutPoint& outPoint) const {
+			size_t i = hash(outPoint.source, outPoint.outputId) & _mask;
+			while (_slots[i].isUsed) {
+				if (_slots[i].outputId == outPoint.outputId && memcmp(_slots[i].source.b, outPoint.source.b, sizeof(outPoint.source.b)) == 0) {
+					return i;
+				}
+				i = (i + 1) & _mask;
+			}
+			return NO_SLOT;
+		}
+
+		void UtxoSet::rehash(size_t capacity) {
+			vector<Slot> slots(capacity);
+			size_t mask = capacity - 1;
+
+			for (size_t k = 0; k < _slots.size(); ++k) {
+				if (_slots[k].isUsed) {
+					size_t i = hash(_slots[k].source, _slots[k].outputId) & mask;
+					while (slots[i].isUsed) {
+						i = (i + 1) & mask;
+					}
+					slots[i] = _slots[k];
+				}
+			}
+
+			_slots.swap(slots);
+			_mask = mask;
+		}
+
+		void UtxoSet::applyTransactions(const Block& b, const b120* transactionIds, UtxoUndo& undo, vector<byte>& buffer) {
+			// The spends of a MasterBlock were checked beforehand, so for it the failures below can only come from
+			// a broken invariant. They cost nothing to detect and still roll the change back.
+			for (uint16_t k = 0; k < b.getTransactionCount(); ++k) {
+				const TransactionVariant& t = b.getTransaction(k);
+
+				const TransactionInput* input = getTransactionInput(t);
+				if (input) {
+					UnspentOutput spent;
+					spent.outPoint.source = input->source;
+					spent.outPoint.outputId = input->sourceOutputId;
+					if (!erase(spent.outPoint, &spent.output)) {
+						throw runtime_error("Transaction input refers to a missing or already spent output '" + spent.outPoint.source.toString() + ":" + std::to_string(spent.outPoint.outputId) + "'.");
+					}
+					undo.spent.push_back(spent);
+				}
+
+				OutPoint created;
+				created.source = transactionIds ? transactionIds[k] : getTransactionId(t, buffer);
+
+				const TransactionOutputs& outputs = getTransactionOutputs(t);
+				for (uint16_t i = 0; i < outputs.size(); ++i) {
+					created.outputId = i;
+					if (!insert(created, outputs[i])) {
+						throw runtime_error("Transaction output '" + created.source.toString() + ":" + std::to_string(i) + "' already exists in the ecrp::blockchain::UtxoSet.");
+					}
+					undo.created.push_back(created);
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
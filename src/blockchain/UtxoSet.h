@@ -0,0 +1,123 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+#include "crypto/Crypto.h"
+#include "transactions/TransactionOutput.h"
+#include "Block.h"
+#include "MasterBlock.h"
+
+using ecrp::crypto::b120;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		struct OutPoint {
+			b120 source; // id of the transaction which created the output
+			uint16_t outputId;
+		};
+
+		struct OutPointHash {
+			size_t operator()(const OutPoint& o) const;
+		};
+
+		struct OutPointEqual {
+			bool operator()(const OutPoint& a, const OutPoint& b) const;
+		};
+
+		struct UnspentOutput {
+			OutPoint outPoint;
+			TransactionOutput output;
+		};
+
+		// What applying a block changed, so that it can be reverted without reading the chain again.
+		struct UtxoUndo {
+			vector<UnspentOutput> spent;
+			vector<OutPoint> created;
+		};
+
+		// Set of the unspent transaction outputs, kept in a flat open-addressing table with linear probing.
+		// Slots are stored inline in a single array so that a lookup touches one or two cache lines, and
+		// removals use backward-shift deletion so that no tombstone ever slows the probes down.
+		class UtxoSet {
+
+		private: // CONSTANTS
+
+			static const size_t MIN_CAPACITY = 1024;
+			static const size_t MAX_LOAD_PERCENT = 70;
+			static const uint16_t SNAPSHOT_VERSION = 1;
+			static const size_t SNAPSHOT_HEADER_SIZE = sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint64_t);
+			static const size_t SNAPSHOT_ENTRY_SIZE = sizeof(b120) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(b120);
+			static const size_t SNAPSHOT_BATCH_SIZE = 4096;
+
+		private: // TYPES
+
+			struct Slot {
+				uint64_t amount;
+				b120 source;
+				b120 address;
+				uint16_t outputId;
+				bool isUsed;
+			};
+
+		private: // MEMBERS
+
+			vector<Slot> _slots;
+			size_t _mask;
+			size_t _count;
+
+		public: // CONSTRUCTORS
+
+			UtxoSet();
+
+			virtual ~UtxoSet();
+
+		public: // METHODS
+
+			void reserve(size_t count);
+			void clear();
+			size_t size() const;
+
+			bool find(const OutPoint& outPoint, TransactionOutput& output) const;
+			bool insert(const OutPoint& outPoint, const TransactionOutput& output);
+			bool erase(const OutPoint& outPoint, TransactionOutput* output = NULL);
+
+			// Spends the inputs and adds the outputs of every transaction, in order. On failure the
+			// set is left untouched; on success the undo record describes how to revert the change.
+			void applyBlock(const Block& b, UtxoUndo& undo);
+
+			// The spends of the MasterBlock must have been checked by BlockValidator::checkSpends, which also
+			// gives the ids of its transactions in order, so that they are not hashed a second time here.
+			void applyMasterBlock(MasterBlock& mb, const vector<b120>& transactionIds, UtxoUndo& undo);
+			void revert(const UtxoUndo& undo);
+
+			// A snapshot is the (version, MasterBlock id, count) header followed by fixed-size entries. It is
+			// written to a temporary file renamed over the previous one, so a crash never leaves a partial
+			// snapshot behind; a snapshot which cannot be used is simply ignored and the set left empty.
+			// Loading inserts the entries one by one into a table sized for them up front rather than mapping the
+			// file, since the layout of the table depends on its capacity and the snapshot does not.
+			void save(const string& filename, uint32_t masterBlockId) const;
+			bool load(const string& filename, uint32_t& masterBlockId);
+
+			// The set is not indexed by address, so these two scan the whole table, in time linear in its capacity.
+			// They serve wallets and tools; nothing on the validation path calls them.
+			uint64_t getBalance(const b120& address) const;
+			void getOutputsForAddress(const b120& address, vector<UnspentOutput>& outputs) const;
+
+		private: // METHODS
+
+			size_t hash(const b120& source, uint16_t outputId) const;
+			size_t findSlot(const OutPoint& outPoint) const;
+			void rehash(size_t capacity);
+			void applyTransactions(const Block& b, const b120* transactionIds, UtxoUndo& undo, vector<byte>& buffer);
+
+		};
+	}
+}
\ No newline at end of file
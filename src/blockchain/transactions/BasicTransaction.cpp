@@ -1,7 +1,11 @@
 
+#include <cstring>
+#include <stdexcept>
+
+using std::runtime_error;
+
 #include "BasicTransaction.h"
 #include "blockchain/TransactionType.h"
-#include "errors/Error.h"
 
 //----------------------------------------------------------------------
 
@@ -12,28 +16,55 @@ namespace ecrp {
 		}
 
 		BasicTransaction::~BasicTransaction() {
-			for (uint16_t i = 0; i < _outputs.size(); ++i) {
-				delete _outputs[i];
-			}
-			_outputs.clear();
 		}
 
-		void BasicTransaction::deserialize(be_ptr_istream& stream) {
+		void BasicTransaction::deserialize(be_ptr_istream& stream, Arena* arena) {
 			Transaction::deserialize(stream);
 
+			if (_type != TransactionType::BASIC) {
+				throw runtime_error("Unexpected type '" + std::to_string(_type) + "' for an ecrp::blockchain::BasicTransaction.");
+			}
+
 			_input.deserialize(stream);
+			_outputs.deserialize(stream, arena);
+		}
 
-			uint16_t outputCount;
-			stream >> outputCount;
-			for (uint16_t i = 0; i < outputCount; ++i) {
-				TransactionOutput* t = new TransactionOutput();
-				t->deserialize(stream);
-				_outputs.push_back(t);
-			}
+		void BasicTransaction::serialize(be_ptr_ostream& stream) const {
+			Transaction::serialize(stream);
+
+			_input.serialize(stream);
+			_outputs.serialize(stream);
+		}
+
+		size_t BasicTransaction::serializedSize() const {
+			return Transaction::serializedSize() + _input.serializedSize() + _outputs.serializedSize();
+		}
+
+		b256 BasicTransaction::getSigningHash(vector<byte>& buffer) const {
+			buffer.resize(serializedSize());
+			be_ptr_ostream stream(buffer.data(), buffer.size());
+			serialize(stream);
+
+			size_t signatureOffset = Transaction::serializedSize() + sizeof(_input.source) + sizeof(_input.sourceOutputId);
+			memset(buffer.data() + signatureOffset, 0, sizeof(_input.signatureR) + sizeof(_input.signatureS));
+
+			return ecrp::crypto::sha256(buffer.data(), buffer.size());
+		}
+
+		void BasicTransaction::setInput(const TransactionInput& i) {
+			_input = i;
+		}
+
+		void BasicTransaction::addOutput(const TransactionOutput& o) {
+			_outputs.add(o);
+		}
+
+		const TransactionInput& BasicTransaction::getInput() const {
+			return _input;
 		}
 
-		void BasicTransaction::addOutput(TransactionOutput* o) {
-			_outputs.push_back(o);
+		const TransactionOutputs& BasicTransaction::getOutputs() const {
+			return _outputs;
 		}
 	}
 }
\ No newline at end of file
@@ -7,34 +7,47 @@ using std::vector;
 
 #include "blockchain/Transaction.h"
 #include "TransactionInput.h"
-#include "TransactionOutput.h"
+#include "TransactionOutputs.h"
 
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::Arena;
 
 //----------------------------------------------------------------------
 
 namespace ecrp {
 	namespace blockchain {
 
-		// NB: transactions should be split based on their inputs' previous tx address in order to prevent double spending? 
+		// NB: double spends are detected by BlockValidator::checkSpends, which splits the transactions of a
+		// MasterBlock into shards based on their input's source, so that conflicting spends always meet.
 
-		class BasicTransaction : Transaction {
+		class BasicTransaction : public Transaction {
 
 		private: // MEMBERS
 
 			TransactionInput _input;
-			vector<TransactionOutput*> _outputs;
+			TransactionOutputs _outputs;
 
 		public: // CONSTRUCTORS
 
 			BasicTransaction();
-			virtual ~BasicTransaction();
+			~BasicTransaction();
 
 		public: // METHODS
 
-			void addOutput(TransactionOutput* o);
+			void setInput(const TransactionInput& i);
+			void addOutput(const TransactionOutput& o);
 
-			virtual void deserialize(be_ptr_istream& stream);
+			const TransactionInput& getInput() const;
+			const TransactionOutputs& getOutputs() const;
+
+			// The signed message: the sha256 of the serialized transaction with a zeroed signature.
+			// The buffer is only scratch space and can be reused.
+			b256 getSigningHash(vector<byte>& buffer) const;
+
+			void deserialize(be_ptr_istream& stream, Arena* arena = NULL);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
 
 		};
 	}
@@ -0,0 +1,16 @@
+
+#include "FeeTransaction.h"
+#include "blockchain/TransactionType.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		FeeTransaction::FeeTransaction() : OutputOnlyTransaction(TransactionType::FEE) {
+		}
+
+		FeeTransaction::~FeeTransaction() {
+		}
+	}
+}
\ No newline at end of file
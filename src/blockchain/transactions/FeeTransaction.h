@@ -0,0 +1,21 @@
+
+#pragma once
+
+#include "OutputOnlyTransaction.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// A fee transaction has no input, it only creates outputs.
+		class FeeTransaction : public OutputOnlyTransaction {
+
+		public: // CONSTRUCTORS
+
+			FeeTransaction();
+			~FeeTransaction();
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+
+#include <stdexcept>
+
+using std::runtime_error;
+
+#include "OutputOnlyTransaction.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		OutputOnlyTransaction::OutputOnlyTransaction(uint8_t type) : Transaction(type) {
+		}
+
+		OutputOnlyTransaction::~OutputOnlyTransaction() {
+		}
+
+		void OutputOnlyTransaction::deserialize(be_ptr_istream& stream, Arena* arena) {
+			uint8_t expectedType = _type;
+			Transaction::deserialize(stream);
+
+			if (_type != expectedType) {
+				throw runtime_error("Unexpected ecrp::blockchain::Transaction type '" + std::to_string(_type) + "' instead of '" + std::to_string(expectedType) + "'.");
+			}
+
+			_outputs.deserialize(stream, arena);
+		}
+
+		void OutputOnlyTransaction::serialize(be_ptr_ostream& stream) const {
+			Transaction::serialize(stream);
+			_outputs.serialize(stream);
+		}
+
+		size_t OutputOnlyTransaction::serializedSize() const {
+			return Transaction::serializedSize() + _outputs.serializedSize();
+		}
+
+		void OutputOnlyTransaction::addOutput(const TransactionOutput& o) {
+			_outputs.add(o);
+		}
+
+		const TransactionOutputs& OutputOnlyTransaction::getOutputs() const {
+			return _outputs;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include "blockchain/Transaction.h"
+#include "TransactionOutputs.h"
+
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::Arena;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// Shared part of the transactions which have no input and only create outputs. The concrete types
+		// only differ by their type byte, which deserialize() checks against the one given at construction.
+		class OutputOnlyTransaction : public Transaction {
+
+		protected: // MEMBERS
+
+			TransactionOutputs _outputs;
+
+		protected: // CONSTRUCTORS
+
+			OutputOnlyTransaction(uint8_t type);
+			~OutputOnlyTransaction();
+
+		public: // METHODS
+
+			void addOutput(const TransactionOutput& o);
+
+			const TransactionOutputs& getOutputs() const;
+
+			void deserialize(be_ptr_istream& stream, Arena* arena = NULL);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
+
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+
+#include "RewardTransaction.h"
+#include "blockchain/TransactionType.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		RewardTransaction::RewardTransaction() : OutputOnlyTransaction(TransactionType::REWARD) {
+		}
+
+		RewardTransaction::~RewardTransaction() {
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+
+#pragma once
+
+#include "OutputOnlyTransaction.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// A reward transaction has no input, it only creates outputs.
+		class RewardTransaction : public OutputOnlyTransaction {
+
+		public: // CONSTRUCTORS
+
+			RewardTransaction();
+			~RewardTransaction();
+
+		};
+	}
+}
\ No newline at end of file
@@ -17,5 +17,17 @@ namespace ecrp {
 			stream >> signatureS;
 			stream >> publicKey;
 		}
+
+		void TransactionInput::serialize(be_ptr_ostream& stream) const {
+			stream << source;
+			stream << sourceOutputId;
+			stream << signatureR;
+			stream << signatureS;
+			stream << publicKey;
+		}
+
+		size_t TransactionInput::serializedSize() const {
+			return sizeof(source) + sizeof(sourceOutputId) + sizeof(signatureR) + sizeof(signatureS) + sizeof(publicKey);
+		}
 	}
 }
\ No newline at end of file
@@ -14,5 +14,14 @@ namespace ecrp {
 			stream >> amount;
 			stream >> address;
 		}
+
+		void TransactionOutput::serialize(be_ptr_ostream& stream) const {
+			stream << amount;
+			stream << address;
+		}
+
+		size_t TransactionOutput::serializedSize() const {
+			return sizeof(amount) + sizeof(address);
+		}
 	}
 }
\ No newline at end of file
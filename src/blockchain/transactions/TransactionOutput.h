@@ -7,6 +7,7 @@
 #include "crypto/Crypto.h"
 
 using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
 using ecrp::crypto::b120;
 
 //----------------------------------------------------------------------
@@ -24,6 +25,8 @@ namespace ecrp {
 		public: // METHODS
 
 			void deserialize(be_ptr_istream& stream);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
 
 		};
 	}
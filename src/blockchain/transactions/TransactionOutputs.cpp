@@ -0,0 +1,109 @@
+
+#include <stdexcept>
+#include <new>
+#include <type_traits>
+
+using std::runtime_error;
+
+#include "TransactionOutputs.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		TransactionOutputs::TransactionOutputs() {
+			_data = NULL;
+			_size = 0;
+		}
+
+		TransactionOutputs::TransactionOutputs(const TransactionOutputs& other) : _owned(other.begin(), other.end()) {
+			_data = _owned.data();
+			_size = _owned.size();
+		}
+
+		TransactionOutputs& TransactionOutputs::operator=(const TransactionOutputs& other) {
+			if (this != &other) {
+				_owned.assign(other.begin(), other.end());
+				_data = _owned.data();
+				_size = _owned.size();
+			}
+			return *this;
+		}
+
+		void TransactionOutputs::add(const TransactionOutput& o) {
+			// a view is turned into owned outputs before growing
+			if (_data != _owned.data()) {
+				_owned.assign(begin(), end());
+			}
+			_owned.push_back(o);
+			_data = _owned.data();
+			_size = _owned.size();
+		}
+
+		size_t TransactionOutputs::size() const {
+			return _size;
+		}
+
+		bool TransactionOutputs::empty() const {
+			return _size == 0;
+		}
+
+		const TransactionOutput& TransactionOutputs::operator[](size_t i) const {
+			return _data[i];
+		}
+
+		const TransactionOutput* TransactionOutputs::begin() const {
+			return _data;
+		}
+
+		const TransactionOutput* TransactionOutputs::end() const {
+			return _data + _size;
+		}
+
+		void TransactionOutputs::deserialize(be_ptr_istream& stream, Arena* arena) {
+			uint16_t outputCount;
+			stream >> outputCount;
+
+			// the arena never runs the destructors of what is built in its raw memory
+			static_assert(std::is_trivially_destructible<TransactionOutput>::value, "Outputs in an arena must not need a destructor.");
+
+			TransactionOutput* outputs;
+			if (arena && outputCount > 0) {
+				outputs = static_cast<TransactionOutput*>(arena->allocate(outputCount * sizeof(TransactionOutput), alignof(TransactionOutput)));
+				for (uint16_t i = 0; i < outputCount; ++i) {
+					new (&outputs[i]) TransactionOutput();
+				}
+				_owned.clear();
+			} else {
+				_owned.resize(outputCount);
+				outputs = _owned.data();
+			}
+
+			for (uint16_t i = 0; i < outputCount; ++i) {
+				outputs[i].deserialize(stream);
+			}
+			_data = outputs;
+			_size = outputCount;
+		}
+
+		void TransactionOutputs::serialize(be_ptr_ostream& stream) const {
+			if (_size > UINT16_MAX) {
+				throw runtime_error("Too many outputs in an ecrp::blockchain::TransactionOutputs.");
+			}
+
+			stream << (uint16_t)_size;
+			for (size_t i = 0; i < _size; ++i) {
+				_data[i].serialize(stream);
+			}
+		}
+
+		size_t TransactionOutputs::serializedSize() const {
+			size_t size = sizeof(uint16_t);
+			for (size_t i = 0; i < _size; ++i) {
+				size += _data[i].serializedSize();
+			}
+			return size;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+#include "TransactionOutput.h"
+#include "utils/arena.h"
+
+using ecrp::io::be_ptr_istream;
+using ecrp::io::be_ptr_ostream;
+using ecrp::Arena;
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace blockchain {
+
+		// The outputs of a transaction. When decoded with an arena, they are a view on the arena's memory, so that
+		// decoding a Block does not allocate per transaction; the arena must then outlive them, like the Block does.
+		// Otherwise, and in any copy, the outputs live in a vector of their own, so a copy is always safe to keep.
+		class TransactionOutputs {
+
+		private: // MEMBERS
+
+			const TransactionOutput* _data;
+			size_t _size;
+			vector<TransactionOutput> _owned;
+
+		public: // CONSTRUCTORS
+
+			TransactionOutputs();
+			TransactionOutputs(const TransactionOutputs& other);
+
+			TransactionOutputs& operator=(const TransactionOutputs& other);
+
+		public: // METHODS
+
+			void add(const TransactionOutput& o);
+
+			size_t size() const;
+			bool empty() const;
+			const TransactionOutput& operator[](size_t i) const;
+			const TransactionOutput* begin() const;
+			const TransactionOutput* end() const;
+
+			void deserialize(be_ptr_istream& stream, Arena* arena);
+			void serialize(be_ptr_ostream& stream) const;
+			size_t serializedSize() const;
+
+		};
+	}
+}
\ No newline at end of file
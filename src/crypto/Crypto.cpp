@@ -158,26 +158,11 @@ namespace ecrp {
 			printf("%.*s", (int)size, buf);
 		}
 
-		static void hash(int algo, const void* pInputData, size_t inputSize, void* pOutputData, size_t outputSize) {
-			gcry_md_hd_t hd;
-			gpg_error_t err;
-			err = gcry_md_open(&hd, algo, 0);
-			if (err) {
-				throw Error("Initializing hash algorithm failed: %d", err);
-			}
-			gcry_md_write(hd, pInputData, inputSize);
-			byte* hash = gcry_md_read(hd, algo);
-			if (hash == NULL) {
-				gcry_md_close(hd);
-				throw Error("Reading hash failed.");
-			}
-			memcpy(pOutputData, hash, outputSize);
-			gcry_md_close(hd);
-		}
-
 		b256 sha256(const void* pInputData, size_t inputSize) {
 			b256 outputData;
-			hash(GCRY_MD_SHA256, pInputData, inputSize, &outputData, sizeof(outputData));
+			Hasher hasher(GCRY_MD_SHA256);
+			hasher.update(pInputData, inputSize);
+			hasher.final(&outputData, sizeof(outputData));
 			return outputData;
 		}
 	}
@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <memory>
 #include <type_traits>
+#include <typeinfo>
 #include <algorithm>
 #include <gcrypt.h>
 #include <decaf/eddsa.hxx>
@@ -17,12 +18,13 @@ using std::stoul;
 
 #include "utils/byte.h"
 #include "errors/Error.h"
+#include "Hasher.h"
 
 //----------------------------------------------------------------------
 
 namespace ecrp {
 	namespace crypto {
-
+
 		template<size_t n> struct generic_blob {
 			byte b[n];
 
@@ -83,89 +85,127 @@ namespace ecrp {
 
 		extern const char format_E168_generateKey[];
 		extern const char format_E168_generateKey_withSecret[];
-		extern const char format_E168_signData_privateKey[];
-		extern const char format_E168_verifyData_publicKey[];
-		extern const char format_E168_verifyData_signature[];
-		extern const char format_E168_data[];
+		extern const char format_E168_signData_privateKey[];
+		extern const char format_E168_verifyData_publicKey[];
+		extern const char format_E168_verifyData_signature[];
+		extern const char format_E168_data[];
 		extern const char format_Ed25519_generateKey[];
 		extern const char format_Ed25519_generateKey_withSecret[];
-		extern const char format_Ed25519_signData_privateKey[];
-		extern const char format_Ed25519_verifyData_publicKey[];
-		extern const char format_Ed25519_verifyData_signature[];
-		extern const char format_Ed25519_data[];
+		extern const char format_Ed25519_signData_privateKey[];
+		extern const char format_Ed25519_verifyData_publicKey[];
+		extern const char format_Ed25519_verifyData_signature[];
+		extern const char format_Ed25519_data[];
 		extern const char format_Ed448_generateKey[];
 		extern const char format_Ed448_generateKey_withSecret[];
-		extern const char format_Ed448_signData_privateKey[];
-		extern const char format_Ed448_verifyData_publicKey[];
-		extern const char format_Ed448_verifyData_signature[];
-		extern const char format_Ed448_data[];
+		extern const char format_Ed448_signData_privateKey[];
+		extern const char format_Ed448_verifyData_publicKey[];
+		extern const char format_Ed448_verifyData_signature[];
+		extern const char format_Ed448_data[];
+
+		// Binds a blob size to its curve: the decaf primitives and the gcrypt formats. Only the supported curves are
+		// specialized, so any other blob size fails to build, and every call compiles down to a direct one.
+		template<class bXXX> struct CurveTraits {
+			static_assert(sizeof(bXXX) == 0, "There is no curve for this blob size.");
+		};
 
-		template<class bXXX> inline const char* format_generateKey() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_generateKey;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_generateKey;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_generateKey;
+		template<> struct CurveTraits<b176> {
+			static const size_t KEY_SIZE = sizeof(b176);
+			static const size_t SIGNATURE_SIZE = 2 * sizeof(b176);
+
+			static const char* name() { return "E-168"; }
+
+			static void derivePublicKey(uint8_t* q, const uint8_t* d) {
+				decaf_ed168_derive_public_key(q, d);
+			}
+			static void sign(uint8_t* signature, const uint8_t* d, const uint8_t* q, const uint8_t* data, size_t size) {
+				decaf_ed168_sign(signature, d, q, data, size, 0, DECAF_ED168_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
+			}
+			static decaf_error_t verify(const uint8_t* signature, const uint8_t* q, const uint8_t* data, size_t size) {
+				return decaf_ed168_verify(signature, q, data, size, 0, DECAF_ED168_NO_CONTEXT, 0);
+			}
+
+			static const char* format_generateKey() { return format_E168_generateKey; }
+			static const char* format_generateKey_withSecret() { return format_E168_generateKey_withSecret; }
+			static const char* format_signData_privateKey() { return format_E168_signData_privateKey; }
+			static const char* format_verifyData_publicKey() { return format_E168_verifyData_publicKey; }
+			static const char* format_verifyData_signature() { return format_E168_verifyData_signature; }
+			static const char* format_data() { return format_E168_data; }
+		};
+
+		template<> struct CurveTraits<b256> {
+			static const size_t KEY_SIZE = sizeof(b256);
+			static const size_t SIGNATURE_SIZE = 2 * sizeof(b256);
+
+			static const char* name() { return "Ed25519"; }
+
+			static void derivePublicKey(uint8_t* q, const uint8_t* d) {
+				decaf_ed25519_derive_public_key(q, d);
+			}
+			static void sign(uint8_t* signature, const uint8_t* d, const uint8_t* q, const uint8_t* data, size_t size) {
+				decaf_ed25519_sign(signature, d, q, data, size, 0, DECAF_ED25519_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
 			}
+			static decaf_error_t verify(const uint8_t* signature, const uint8_t* q, const uint8_t* data, size_t size) {
+				return decaf_ed25519_verify(signature, q, data, size, 0, DECAF_ED25519_NO_CONTEXT, 0);
+			}
+
+			static const char* format_generateKey() { return format_Ed25519_generateKey; }
+			static const char* format_generateKey_withSecret() { return format_Ed25519_generateKey_withSecret; }
+			static const char* format_signData_privateKey() { return format_Ed25519_signData_privateKey; }
+			static const char* format_verifyData_publicKey() { return format_Ed25519_verifyData_publicKey; }
+			static const char* format_verifyData_signature() { return format_Ed25519_verifyData_signature; }
+			static const char* format_data() { return format_Ed25519_data; }
+		};
+
+		template<> struct CurveTraits<b456> {
+			static const size_t KEY_SIZE = sizeof(b456);
+			static const size_t SIGNATURE_SIZE = 2 * sizeof(b456);
+
+			static const char* name() { return "Ed448"; }
+
+			static void derivePublicKey(uint8_t* q, const uint8_t* d) {
+				decaf_ed448_derive_public_key(q, d);
+			}
+			static void sign(uint8_t* signature, const uint8_t* d, const uint8_t* q, const uint8_t* data, size_t size) {
+				decaf_ed448_sign(signature, d, q, data, size, 0, DECAF_ED448_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
+			}
+			static decaf_error_t verify(const uint8_t* signature, const uint8_t* q, const uint8_t* data, size_t size) {
+				return decaf_ed448_verify(signature, q, data, size, 0, DECAF_ED448_NO_CONTEXT, 0);
+			}
+
+			static const char* format_generateKey() { return format_Ed448_generateKey; }
+			static const char* format_generateKey_withSecret() { return format_Ed448_generateKey_withSecret; }
+			static const char* format_signData_privateKey() { return format_Ed448_signData_privateKey; }
+			static const char* format_verifyData_publicKey() { return format_Ed448_verifyData_publicKey; }
+			static const char* format_verifyData_signature() { return format_Ed448_verifyData_signature; }
+			static const char* format_data() { return format_Ed448_data; }
+		};
+
+		template<class bXXX> inline const char* format_generateKey() {
+			return CurveTraits<bXXX>::format_generateKey();
 		}
 		template<class bXXX> inline const char* format_generateKey_withSecret() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_generateKey_withSecret;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_generateKey_withSecret;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_generateKey_withSecret;
-			}
+			return CurveTraits<bXXX>::format_generateKey_withSecret();
 		}
 		template<class bXXX> inline const char* format_signData_privateKey() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_signData_privateKey;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_signData_privateKey;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_signData_privateKey;
-			}
+			return CurveTraits<bXXX>::format_signData_privateKey();
 		}
 		template<class bXXX> inline const char* format_verifyData_publicKey() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_verifyData_publicKey;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_verifyData_publicKey;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_verifyData_publicKey;
-			}
+			return CurveTraits<bXXX>::format_verifyData_publicKey();
 		}
 		template<class bXXX> inline const char* format_verifyData_signature() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_verifyData_signature;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_verifyData_signature;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_verifyData_signature;
-			}
+			return CurveTraits<bXXX>::format_verifyData_signature();
 		}
 		template<class bXXX> inline const char* format_data() {
-			if (std::is_same<bXXX,b176>::value) {
-				return format_E168_data;
-			} else if (std::is_same<bXXX,b256>::value) {
-				return format_Ed25519_data;
-			} else if (std::is_same<bXXX,b456>::value) {
-				return format_Ed448_data;
-			}
+			return CurveTraits<bXXX>::format_data();
 		}
 
+		// The blob given only selects the output size.
 		template<size_t n> generic_blob<n> shake256(const void* pInputData, size_t inputSize, const generic_blob<n>& outputData) {
-			gcry_md_hd_t hd;
-			gpg_error_t err;
-			gcry_md_open(&hd, GCRY_MD_SHAKE256, 0);
-			gcry_md_write(hd, pInputData, inputSize);
-			err = gcry_md_extract(hd, GCRY_MD_SHAKE256, (void*)&outputData, n);
-			if (err) {
-				throw Error("Extracting hash failed: %s", gcry_strerror(err));
-			}
-			gcry_md_close(hd);
-			return outputData;
+			generic_blob<n> result;
+			Hasher hasher(GCRY_MD_SHAKE256);
+			hasher.update(pInputData, inputSize);
+			hasher.final(&result, n);
+			return result;
 		}
 
 		template<class bXXX> struct PublicKey {
@@ -207,255 +247,272 @@ namespace ecrp {
 		typedef DerivativeKey<b456> StrongDerivativeKey;
 		typedef Signature<b456> StrongSignature;
 
+		// One of the messages hashed together by sha256_many.
+		struct HashInput {
+			const void* pData;
+			size_t size;
+		};
+
+		// The SHA-256 state once the first full blocks of a message are compressed, shared by the messages
+		// which start with the same bytes.
+		struct Sha256Midstate {
+			uint32_t state[8];
+			uint64_t size;
+		};
+
 		b256 sha256(const void* pInputData, size_t inputSize);
 
+		// Hashes independent messages several at a time, one per SIMD lane (8 with AVX2, 4 with SSE2), falling
+		// back on sha256 when the CPU has neither or has the SHA extensions. Gives the same digests as sha256.
+		void sha256_many(const HashInput* pInputs, b256* pOutputs, size_t count);
+
+		// Compresses the full 64-byte blocks of the prefix, output.size telling how many bytes that is.
+		void sha256_midstate(const void* pPrefixData, size_t prefixSize, Sha256Midstate& output);
+
+		// Like sha256_many, every message being what follows the first midstate.size bytes of the prefix, so that
+		// only its own blocks are compressed. Always runs on the SIMD kernels when the CPU has one.
+		void sha256_many(const Sha256Midstate& midstate, const HashInput* pInputs, b256* pOutputs, size_t count);
+
 		enum Deterministic {
 			RANDOM = 0,
 			DETERMINISTIC = 1
 		};
 
+		// Curve primitives shared by both APIs.
+		template<class bXXX> inline void derivePublicKey(bXXX& q, const bXXX& d) {
+			CurveTraits<bXXX>::derivePublicKey((uint8_t*)&q, (const uint8_t*)&d);
+		}
+
+		template<class bXXX> inline void signWithKey(const void* pInputData, size_t inputSize, const bXXX& d, const bXXX& q, Signature<bXXX>& output) {
+			static_assert(sizeof(output) == CurveTraits<bXXX>::SIGNATURE_SIZE, "A signature must be the (r, s) pair alone.");
+			CurveTraits<bXXX>::sign((uint8_t*)&output, (const uint8_t*)&d, (const uint8_t*)&q, (const uint8_t*)pInputData, inputSize);
+		}
+
+		template<class bXXX> inline bool verifyWithKey(const void* pInputData, size_t inputSize, const Signature<bXXX>& signature, const bXXX& q) {
+			return CurveTraits<bXXX>::verify((const uint8_t*)&signature, (const uint8_t*)&q, (const uint8_t*)pInputData, inputSize) == DECAF_SUCCESS;
+		}
+
 		template<class bXXX> void generateKey(PrivateKey<bXXX>* pOutput, const void* pSecretData, size_t secretSize, bool isRaw) {
 			memset(&pOutput->q, 0, sizeof(pOutput->q));
-
-			decaf_keccak_prng_t sp;
-			decaf_spongerng_init_from_buffer(sp, (const uint8_t*)BASE_IV, sizeof(BASE_IV), DETERMINISTIC); // RANDOM
-			//decaf_spongerng_stir(sp, (const uint8_t*)&d, sizeof(d));
-
-			if (pSecretData && secretSize) {
-				if (isRaw) {
-					if (secretSize >= sizeof(pOutput->d)) {
-						memcpy(&pOutput->d, pSecretData, sizeof(pOutput->d));
-					} else {
-						throw Error("Not enough secret data.");
-					}
-				} else {
-					decaf_shake256_hash((uint8_t*)&pOutput->d, sizeof(pOutput->d), (uint8_t*)pSecretData, secretSize);
-				}
-			} else {
-				decaf_spongerng_next(sp, (uint8_t*)&pOutput->d, sizeof(pOutput->d));
-			}
-
-			decaf_spongerng_destroy(sp);
-			
-			if (std::is_same<bXXX, b176>::value) {
-				decaf_ed168_derive_public_key((uint8_t*)&pOutput->q, (uint8_t*)&pOutput->d);
-			} else if (std::is_same<bXXX, b256>::value) {
-				decaf_ed25519_derive_public_key((uint8_t*)&pOutput->q, (uint8_t*)&pOutput->d);
-			} else if (std::is_same<bXXX, b456>::value) {
-				decaf_ed448_derive_public_key((uint8_t*)&pOutput->q, (uint8_t*)&pOutput->d);
-			}
-
-			if (pOutput->q.b[0] == 0) {
-				throw Error("Unable to generate a key.");
-			}
+
+			decaf_keccak_prng_t sp;
+			decaf_spongerng_init_from_buffer(sp, (const uint8_t*)BASE_IV, sizeof(BASE_IV), DETERMINISTIC); // RANDOM
+			//decaf_spongerng_stir(sp, (const uint8_t*)&d, sizeof(d));
+
+			if (pSecretData && secretSize) {
+				if (isRaw) {
+					if (secretSize >= sizeof(pOutput->d)) {
+						memcpy(&pOutput->d, pSecretData, sizeof(pOutput->d));
+					} else {
+						throw Error("Not enough secret data.");
+					}
+				} else {
+					decaf_shake256_hash((uint8_t*)&pOutput->d, sizeof(pOutput->d), (uint8_t*)pSecretData, secretSize);
+				}
+			} else {
+				decaf_spongerng_next(sp, (uint8_t*)&pOutput->d, sizeof(pOutput->d));
+			}
+
+			decaf_spongerng_destroy(sp);
+
+			derivePublicKey(pOutput->q, pOutput->d);
+
+			if (pOutput->q.b[0] == 0) {
+				throw Error("Unable to generate a key.");
+			}
+		}
+
+		// Allocation-free API: results go to caller storage and scratch data stays on the stack. A derivative
+		// key does not sign with its d, so it goes through signDataWithDerivativeKey(), signData() refusing it,
+		// or any other key type derived from PrivateKey, at compile time. It must still not be passed as a
+		// PrivateKey reference.
+
+		template<class bXXX> void generateKey(PrivateKey<bXXX>& output) {
+			generateKey(&output, NULL, 0, true);
+		}
+
+		template<class bXXX> void deriveKey(const PrivateKey<bXXX>& sourceKey, uint32_t kValue, DerivativeKey<bXXX>& output) {
+			byte secretData[sizeof(sourceKey.d) + sizeof(kValue)];
+			memcpy(secretData, &sourceKey.d, sizeof(sourceKey.d));
+			memcpy(secretData + sizeof(sourceKey.d), &kValue, sizeof(kValue));
+			generateKey(&output, secretData, sizeof(secretData), false);
+			memcpy(&output.d, &sourceKey.d, sizeof(sourceKey.d));
+			output.k = kValue;
+		}
+
+		template<class bXXX> void signData(const void* pInputData, size_t inputSize, const PrivateKey<bXXX>& privateKey, Signature<bXXX>& output) {
+			signWithKey(pInputData, inputSize, privateKey.d, privateKey.q, output);
+		}
+
+		// an exact match for every key derived from PrivateKey, which would otherwise be sliced into one
+		template<class K, class bXXX> typename std::enable_if<std::is_base_of<PrivateKey<bXXX>, K>::value && !std::is_same<K, PrivateKey<bXXX> >::value>::type
+			signData(const void* pInputData, size_t inputSize, const K& key, Signature<bXXX>& output) = delete;
+
+		template<class bXXX> void signDataWithDerivativeKey(const void* pInputData, size_t inputSize, const DerivativeKey<bXXX>& derivativeKey, Signature<bXXX>& output) {
+			// the signing secret is the one deriveKey() derived the public key from
+			byte sbuf[sizeof(derivativeKey.d) + sizeof(derivativeKey.k)];
+			memcpy(sbuf, &derivativeKey.d, sizeof(derivativeKey.d));
+			memcpy(sbuf + sizeof(derivativeKey.d), &derivativeKey.k, sizeof(derivativeKey.k));
+			bXXX d;
+			decaf_shake256_hash((uint8_t*)&d, sizeof(d), (const uint8_t*)sbuf, sizeof(sbuf));
+			signWithKey(pInputData, inputSize, d, derivativeKey.q, output);
+		}
+
+		template<class bXXX> bool verifyData(const void* pInputData, size_t inputSize, const Signature<bXXX>& signature, const PublicKey<bXXX>& publicKey) {
+			return verifyWithKey(pInputData, inputSize, signature, publicKey.q);
 		}
 
+		// Allocating API, kept for the existing callers.
+
 		template<class bXXX> PrivateKey<bXXX>* generateKey() {
 			PrivateKey<bXXX> output;
-			generateKey(&output, NULL, 0, true);
+			generateKey(output);
 			return new PrivateKey<bXXX>(output);
 		}
 
 		template<class bXXX> DerivativeKey<bXXX>* deriveKey(const PrivateKey<bXXX>* pSourceKey, uint32_t kValue) {
-			size_t secretSize = sizeof(pSourceKey->d) + sizeof(kValue);
-			std::unique_ptr<byte> secretData(new byte[secretSize]);
-			memcpy(secretData.get(), &pSourceKey->d, sizeof(pSourceKey->d));
-			memcpy(secretData.get() + sizeof(pSourceKey->d), &kValue, sizeof(kValue));
 			DerivativeKey<bXXX> output;
-			generateKey(&output, secretData.get(), secretSize, false);
-			memcpy(&output.d, &pSourceKey->d, sizeof(pSourceKey->d));
-			output.k = kValue;
+			deriveKey(*pSourceKey, kValue, output);
 			return new DerivativeKey<bXXX>(output);
 		}
 
+		// Unlike the allocation-free API, the key is told apart at run time, so a DerivativeKey given through a
+		// PrivateKey pointer still signs with its derived secret.
 		template<class bXXX> Signature<bXXX>* signData(const void* pInputData, size_t inputSize, const PrivateKey<bXXX>* pPrivateKey) {
 			Signature<bXXX> output;
-			PrivateKey<bXXX> key;
-
-			if (typeid(*pPrivateKey) == typeid(DerivativeKey<bXXX>)) {
-				const DerivativeKey<bXXX>* pDerivativeKey = (const DerivativeKey<bXXX>*)(pPrivateKey);
-				size_t slen = sizeof(pDerivativeKey->d) + sizeof(pDerivativeKey->k);
-				std::unique_ptr<byte> sbuf(new byte[slen]);
-				memcpy(sbuf.get(), &pDerivativeKey->d, sizeof(pDerivativeKey->d));
-				memcpy(sbuf.get() + sizeof(pDerivativeKey->d), &pDerivativeKey->k, sizeof(pDerivativeKey->k));
-				decaf_shake256_hash((uint8_t*)&key.d, sizeof(key.d), (const uint8_t*)sbuf.get(), slen);
-			} else {
-				memcpy(&key.d, &pPrivateKey->d, sizeof(pPrivateKey->d));
-				memcpy(&key.q, &pPrivateKey->q, sizeof(pPrivateKey->q));
-			}
-
-			if (std::is_same<bXXX, b176>::value) {
-				decaf_ed168_sign((uint8_t*)&output, (const uint8_t*)&key.d, (const uint8_t*)&key.q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED168_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
-			} else if (std::is_same<bXXX, b256>::value) {
-				decaf_ed25519_sign((uint8_t*)&output, (const uint8_t*)&key.d, (const uint8_t*)&key.q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED25519_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
-			} else if (std::is_same<bXXX, b456>::value) {
-				decaf_ed448_sign((uint8_t*)&output, (const uint8_t*)&key.d, (const uint8_t*)&key.q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED448_NO_CONTEXT /*CONTEXT*/, 0); // TODO: choose the right function
+			if (typeid(*pPrivateKey) == typeid(DerivativeKey<bXXX>)) {
+				signDataWithDerivativeKey(pInputData, inputSize, *static_cast<const DerivativeKey<bXXX>*>(pPrivateKey), output);
+			} else {
+				signData(pInputData, inputSize, *pPrivateKey, output);
 			}
 			//cout << "signature.r: " << output.r.toString() << endl;
 			//cout << "signature.s: " << output.s.toString() << endl;
-			return new Signature<bXXX>(output);
+			return new Signature<bXXX>(output);
 		}
 
 		template<class bXXX> Signature<bXXX>* signData_OLD(void* pInputData, size_t inputSize, const PrivateKey<bXXX>* pPrivateKey) {
 			Signature<bXXX> output;
 			void* buffer;
 			uint32_t bufferSize;
-			gpg_error_t err;
-
-			gcry_sexp_t private_key;
-			if (typeid(*pPrivateKey) == typeid(DerivativeKey<bXXX>)) {
-				const DerivativeKey<bXXX>* pDerivativeKey = (const DerivativeKey<bXXX>*)(pPrivateKey);
-				size_t slen = sizeof(pDerivativeKey->d) + sizeof(pDerivativeKey->k);
-				std::unique_ptr<byte> sbuf(new byte[slen]);
-				memcpy(sbuf.get(), &pDerivativeKey->d, sizeof(pDerivativeKey->d));
-				memcpy(sbuf.get() + sizeof(pDerivativeKey->d), &pDerivativeKey->k, sizeof(pDerivativeKey->k));
-				b456 d = shake256(sbuf.get(), slen, b456());
-				err = gcry_sexp_build(&private_key, NULL, format_signData_privateKey<bXXX>(), sizeof(pDerivativeKey->q), &pDerivativeKey->q, sizeof(d), &d);
-			}
-			else {
-				err = gcry_sexp_build(&private_key, NULL, format_signData_privateKey<bXXX>(), sizeof(pPrivateKey->q), &pPrivateKey->q, sizeof(pPrivateKey->d), &pPrivateKey->d);
-			}
-			if (err) {
-				throw Error("Loading private key failed: %d", err);
-			}
-
-			gcry_sexp_t data;
-			err = gcry_sexp_build(&data, NULL, format_data<bXXX>(), inputSize, pInputData);
-			if (err) {
-				gcry_sexp_release(private_key);
-				throw Error("Loading data failed: %d", err);
-			}
-
-			gcry_sexp_t signature;
-			err = gcry_pk_sign(&signature, data, private_key);
-			gcry_sexp_release(private_key);
-			gcry_sexp_release(data);
-			if (err) {
-				throw Error("Signing data failed: %d", err);
-			}
-
-			gcry_sexp_t r_component;
-			r_component = gcry_sexp_find_token(signature, "r", 0);
-			if (!r_component) {
-				gcry_sexp_release(signature);
-				throw Error("R component missing from the private key.");
-			}
-			buffer = (void*)gcry_sexp_nth_data(r_component, 1, &bufferSize);
-			memcpy(&output.r, buffer, sizeof(output.r));
-			gcry_sexp_release(r_component);
-
-			gcry_sexp_t s_component;
-			s_component = gcry_sexp_find_token(signature, "s", 0);
-			if (!s_component) {
-				gcry_sexp_release(signature);
-				throw Error("S component missing from the private key.");
-			}
-			buffer = (void*)gcry_sexp_nth_data(s_component, 1, &bufferSize);
-			memcpy(&output.s, buffer, sizeof(output.s));
-			gcry_sexp_release(s_component);
-
-			gcry_sexp_release(signature);
+			gpg_error_t err;
+
+			gcry_sexp_t private_key;
+			if (typeid(*pPrivateKey) == typeid(DerivativeKey<bXXX>)) {
+				const DerivativeKey<bXXX>* pDerivativeKey = (const DerivativeKey<bXXX>*)(pPrivateKey);
+				byte sbuf[sizeof(pDerivativeKey->d) + sizeof(pDerivativeKey->k)];
+				memcpy(sbuf, &pDerivativeKey->d, sizeof(pDerivativeKey->d));
+				memcpy(sbuf + sizeof(pDerivativeKey->d), &pDerivativeKey->k, sizeof(pDerivativeKey->k));
+				b456 d = shake256(sbuf, sizeof(sbuf), b456());
+				err = gcry_sexp_build(&private_key, NULL, format_signData_privateKey<bXXX>(), sizeof(pDerivativeKey->q), &pDerivativeKey->q, sizeof(d), &d);
+			}
+			else {
+				err = gcry_sexp_build(&private_key, NULL, format_signData_privateKey<bXXX>(), sizeof(pPrivateKey->q), &pPrivateKey->q, sizeof(pPrivateKey->d), &pPrivateKey->d);
+			}
+			if (err) {
+				throw Error("Loading private key failed: %d", err);
+			}
+
+			gcry_sexp_t data;
+			err = gcry_sexp_build(&data, NULL, format_data<bXXX>(), inputSize, pInputData);
+			if (err) {
+				gcry_sexp_release(private_key);
+				throw Error("Loading data failed: %d", err);
+			}
+
+			gcry_sexp_t signature;
+			err = gcry_pk_sign(&signature, data, private_key);
+			gcry_sexp_release(private_key);
+			gcry_sexp_release(data);
+			if (err) {
+				throw Error("Signing data failed: %d", err);
+			}
+
+			gcry_sexp_t r_component;
+			r_component = gcry_sexp_find_token(signature, "r", 0);
+			if (!r_component) {
+				gcry_sexp_release(signature);
+				throw Error("R component missing from the private key.");
+			}
+			buffer = (void*)gcry_sexp_nth_data(r_component, 1, &bufferSize);
+			memcpy(&output.r, buffer, sizeof(output.r));
+			gcry_sexp_release(r_component);
+
+			gcry_sexp_t s_component;
+			s_component = gcry_sexp_find_token(signature, "s", 0);
+			if (!s_component) {
+				gcry_sexp_release(signature);
+				throw Error("S component missing from the private key.");
+			}
+			buffer = (void*)gcry_sexp_nth_data(s_component, 1, &bufferSize);
+			memcpy(&output.s, buffer, sizeof(output.s));
+			gcry_sexp_release(s_component);
+
+			gcry_sexp_release(signature);
 			//cout << "signature.r: " << output.r.toString() << endl;
 			//cout << "signature.s: " << output.s.toString() << endl;
-			return new Signature<bXXX>(output);
+			return new Signature<bXXX>(output);
 		}
 
 		template<class bXXX> bool verifyData(const void* pInputData, size_t inputSize, const Signature<bXXX>* pInputSignature, const PublicKey<bXXX>* pPublicKey) {
-			decaf_error_t err;
-			if (std::is_same<bXXX, b176>::value) {
-				err = decaf_ed168_verify((const uint8_t*)pInputSignature, (const uint8_t*)&pPublicKey->q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED168_NO_CONTEXT, 0);
-			} else if (std::is_same<bXXX, b256>::value) {
-				err = decaf_ed25519_verify((const uint8_t*)pInputSignature, (const uint8_t*)&pPublicKey->q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED25519_NO_CONTEXT, 0);
-			} else if (std::is_same<bXXX, b456>::value) {
-				err = decaf_ed448_verify((const uint8_t*)pInputSignature, (const uint8_t*)&pPublicKey->q, (const uint8_t*)pInputData, inputSize, 0, DECAF_ED448_NO_CONTEXT, 0);
-			}
-			return err == DECAF_SUCCESS;
+			return verifyWithKey(pInputData, inputSize, *pInputSignature, pPublicKey->q);
 		}
 
 		template<class bXXX> bool verifyData_OLD(void* pInputData, size_t inputSize, const Signature<bXXX>* pInputSignature, const PublicKey<bXXX>* pPublicKey) {
-			gpg_error_t err;
-
-			gcry_sexp_t public_key;
-			err = gcry_sexp_build(&public_key, NULL, format_verifyData_publicKey<bXXX>(), sizeof(pPublicKey->q), &pPublicKey->q);
-			if (err) {
-				throw Error("Loading public key failed: %d", err);
-			}
-
-			gcry_sexp_t signature;
-			err = gcry_sexp_build(&signature, NULL, format_verifyData_signature<bXXX>(), sizeof(pInputSignature->r), &pInputSignature->r, sizeof(pInputSignature->s), &pInputSignature->s);
-			if (err) {
-				gcry_sexp_release(public_key);
-				throw Error("Loading signature failed: %d", err);
-			}
-
-			gcry_sexp_t data;
-			err = gcry_sexp_build(&data, NULL, format_data<bXXX>(), inputSize, pInputData);
-			if (err) {
-				gcry_sexp_release(signature);
-				gcry_sexp_release(public_key);
-				throw Error("Loading data failed: %d", err);
-			}
-
-			err = gcry_pk_verify(signature, data, public_key);
-			gcry_sexp_release(signature);
-			gcry_sexp_release(data);
-			gcry_sexp_release(public_key);
-			if (err) {
-				throw Error("Verifying data failed: %d", err);
-			}
-
-			return true;
-		}
-
-		template<class bXXX> b512* lockKey(const PrivateKey<bXXX>* pKey, const string& password) {
 			gpg_error_t err;
 
-			size_t slen = password.size() + sizeof(BASE_SALT) - 1;
-			std::unique_ptr<byte> sbuf(new byte[slen]);
-			memcpy(sbuf.get(), password.c_str(), password.size());
-			memcpy(sbuf.get() + password.size(), BASE_SALT, sizeof(BASE_SALT) - 1);
-			b256 hash = sha256(sbuf.get(), slen);
+			gcry_sexp_t public_key;
+			err = gcry_sexp_build(&public_key, NULL, format_verifyData_publicKey<bXXX>(), sizeof(pPublicKey->q), &pPublicKey->q);
+			if (err) {
+				throw Error("Loading public key failed: %d", err);
+			}
 
-			gcry_cipher_hd_t handle;
-			err = gcry_cipher_open(&handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_ECB, 0);
+			gcry_sexp_t signature;
+			err = gcry_sexp_build(&signature, NULL, format_verifyData_signature<bXXX>(), sizeof(pInputSignature->r), &pInputSignature->r, sizeof(pInputSignature->s), &pInputSignature->s);
 			if (err) {
-				throw Error("Initializing cipher algorithm failed: %d", err);
+				gcry_sexp_release(public_key);
+				throw Error("Loading signature failed: %d", err);
 			}
 
-			err = gcry_cipher_setkey(handle, &hash, sizeof(hash));
+			gcry_sexp_t data;
+			err = gcry_sexp_build(&data, NULL, format_data<bXXX>(), inputSize, pInputData);
 			if (err) {
-				gcry_cipher_close(handle);
-				throw Error("Setting cipher key failed: %d", err);
+				gcry_sexp_release(signature);
+				gcry_sexp_release(public_key);
+				throw Error("Loading data failed: %d", err);
 			}
 
-			err = gcry_cipher_setiv(handle, BASE_IV, sizeof(BASE_IV) - 1);
+			err = gcry_pk_verify(signature, data, public_key);
+			gcry_sexp_release(signature);
+			gcry_sexp_release(data);
+			gcry_sexp_release(public_key);
 			if (err) {
-				gcry_cipher_close(handle);
-				throw Error("Setting cipher IV failed: %d", err);
+				throw Error("Verifying data failed: %d", err);
 			}
 
-			b512 input;
-			memset(&input, 0, sizeof(input));
-			memcpy(&input, &pKey->d, sizeof(pKey->d));
+			return true;
+		}
 
-			b512 output;
-			err = gcry_cipher_encrypt(handle, &output, sizeof(output), &input, sizeof(input));
-			gcry_cipher_close(handle);
+		// sha256 of the password followed by the salt, hashed from both buffers without joining them
+		inline b256 hashPassword(const string& password) {
+			gcry_buffer_t buffers[2];
+			memset(buffers, 0, sizeof(buffers));
+			buffers[0].size = buffers[0].len = password.size();
+			buffers[0].data = (void*)password.data();
+			buffers[1].size = buffers[1].len = sizeof(BASE_SALT) - 1;
+			buffers[1].data = (void*)BASE_SALT;
+
+			b256 hash;
+			gpg_error_t err = gcry_md_hash_buffers(GCRY_MD_SHA256, 0, &hash, buffers, 2);
 			if (err) {
-				throw Error("Encrypting data failed: %d", err);
+				throw Error("Hashing password failed: %d", err);
 			}
-			return new b512(output);
+			return hash;
 		}
 
-		template<class bXXX> PrivateKey<bXXX>* unlockKey(const b512* pInput, const string& password) {
+		// The cipher handle is still allocated by gcrypt, the key and the buffers are not.
+		inline void cipherKey(const b256& hash, const b512& input, b512& output, bool isEncrypting) {
 			gpg_error_t err;
 
-			size_t slen = password.size() + sizeof(BASE_SALT) - 1;
-			std::unique_ptr<byte> sbuf(new byte[slen]);
-			memcpy(sbuf.get(), password.c_str(), password.size());
-			memcpy(sbuf.get() + password.size(), BASE_SALT, sizeof(BASE_SALT) - 1);
-			b256 hash = sha256(sbuf.get(), slen);
-
 			gcry_cipher_hd_t handle;
 			err = gcry_cipher_open(&handle, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_ECB, 0);
 			if (err) {
@@ -474,18 +531,41 @@ namespace ecrp {
 				throw Error("Setting cipher IV failed: %d", err);
 			}
 
-			b512 secret;
-			err = gcry_cipher_decrypt(handle, &secret, sizeof(secret), pInput, sizeof(*pInput));
+			if (isEncrypting) {
+				err = gcry_cipher_encrypt(handle, &output, sizeof(output), &input, sizeof(input));
+			} else {
+				err = gcry_cipher_decrypt(handle, &output, sizeof(output), &input, sizeof(input));
+			}
 			gcry_cipher_close(handle);
 			if (err) {
-				throw Error("Decrypting data failed: %d", err);
+				throw Error(isEncrypting ? "Encrypting data failed: %d" : "Decrypting data failed: %d", err);
 			}
+		}
+
+		template<class bXXX> void lockKey(const PrivateKey<bXXX>& key, const string& password, b512& output) {
+			b512 input;
+			memcpy(&input, &key.d, sizeof(key.d));
+			cipherKey(hashPassword(password), input, output, true);
+		}
+
+		template<class bXXX> void unlockKey(const b512& input, const string& password, PrivateKey<bXXX>& output) {
+			b512 secret;
+			cipherKey(hashPassword(password), input, secret, false);
 
 			b456 d;
 			memcpy(&d, &secret, sizeof(d));
+			generateKey(&output, &d, sizeof(d), true);
+		}
 
+		template<class bXXX> b512* lockKey(const PrivateKey<bXXX>* pKey, const string& password) {
+			b512 output;
+			lockKey(*pKey, password, output);
+			return new b512(output);
+		}
+
+		template<class bXXX> PrivateKey<bXXX>* unlockKey(const b512* pInput, const string& password) {
 			PrivateKey<bXXX> output;
-			generateKey(&output, &d, sizeof(d), true);
+			unlockKey(*pInput, password, output);
 			return new PrivateKey<bXXX>(output);
 		}
 	}
@@ -0,0 +1,106 @@
+
+#include <cstring>
+#include <vector>
+
+using std::vector;
+
+#include "Hasher.h"
+#include "utils/byte.h"
+#include "errors/Error.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+
+		namespace {
+
+			struct PooledContext {
+				int algorithm;
+				gcry_md_hd_t context;
+			};
+
+			// Closes whatever is left when its thread exits.
+			struct ContextPool {
+				vector<PooledContext> contexts;
+
+				~ContextPool() {
+					for (size_t i = 0; i < contexts.size(); ++i) {
+						gcry_md_close(contexts[i].context);
+					}
+				}
+			};
+
+			thread_local ContextPool pool;
+		}
+
+		Hasher::Hasher(int algorithm) {
+			_algorithm = algorithm;
+			_context = acquire(algorithm);
+		}
+
+		Hasher::~Hasher() {
+			release(_algorithm, _context);
+		}
+
+		void Hasher::update(const void* pInputData, size_t inputSize) {
+			gcry_md_write(_context, pInputData, inputSize);
+		}
+
+		void Hasher::final(void* pOutputData, size_t outputSize) {
+			size_t digestSize = gcry_md_get_algo_dlen(_algorithm);
+			if (digestSize == 0) {
+				gpg_error_t err = gcry_md_extract(_context, _algorithm, pOutputData, outputSize);
+				if (err) {
+					throw Error("Extracting hash failed: %s", gcry_strerror(err));
+				}
+			} else {
+				if (outputSize > digestSize) {
+					throw Error("Reading hash failed: %u bytes asked, %u available.", (unsigned)outputSize, (unsigned)digestSize);
+				}
+				byte* hash = gcry_md_read(_context, _algorithm);
+				if (hash == NULL) {
+					throw Error("Reading hash failed.");
+				}
+				memcpy(pOutputData, hash, outputSize);
+			}
+			gcry_md_reset(_context);
+		}
+
+		void Hasher::reset() {
+			gcry_md_reset(_context);
+		}
+
+		gcry_md_hd_t Hasher::acquire(int algorithm) {
+			vector<PooledContext>& contexts = pool.contexts;
+			for (size_t i = contexts.size(); i-- > 0; ) {
+				if (contexts[i].algorithm == algorithm) {
+					gcry_md_hd_t context = contexts[i].context;
+					contexts.erase(contexts.begin() + i);
+					return context;
+				}
+			}
+
+			gcry_md_hd_t context;
+			gpg_error_t err = gcry_md_open(&context, algorithm, 0);
+			if (err) {
+				throw Error("Initializing hash algorithm failed: %d", err);
+			}
+			return context;
+		}
+
+		void Hasher::release(int algorithm, gcry_md_hd_t context) {
+			vector<PooledContext>& contexts = pool.contexts;
+			if (contexts.size() >= MAX_POOLED_CONTEXTS) {
+				gcry_md_close(context);
+				return;
+			}
+
+			gcry_md_reset(context);
+			PooledContext c;
+			c.algorithm = algorithm;
+			c.context = context;
+			contexts.push_back(c);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+
+#pragma once
+
+#include <cstddef>
+#include <gcrypt.h>
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+
+		// Streaming hash over a libgcrypt context borrowed from a per-thread pool, so that hashing a small input
+		// does not cost opening and closing a context each time. The context is reset and given back to the pool
+		// of the destroying thread when the hasher goes away, which also happens when final throws.
+		class Hasher {
+
+		private: // CONSTANTS
+
+			// Contexts kept per thread; most threads only ever hold one or two at a time.
+			static const size_t MAX_POOLED_CONTEXTS = 8;
+
+		private: // MEMBERS
+
+			int _algorithm;
+			gcry_md_hd_t _context;
+
+		public: // CONSTRUCTORS
+
+			Hasher(int algorithm = GCRY_MD_SHA256);
+
+			virtual ~Hasher();
+
+		private:
+
+			Hasher(const Hasher&);
+			Hasher& operator=(const Hasher&);
+
+		public: // METHODS
+
+			void update(const void* pInputData, size_t inputSize);
+
+			// Writes the first outputSize bytes of the digest, or as many bytes as asked of an extendable-output
+			// function such as SHAKE256, then resets the hasher for the next input.
+			void final(void* pOutputData, size_t outputSize);
+
+			void reset();
+
+		private: // METHODS
+
+			static gcry_md_hd_t acquire(int algorithm);
+			static void release(int algorithm, gcry_md_hd_t context);
+
+		};
+	}
+}
\ No newline at end of file
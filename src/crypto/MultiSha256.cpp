@@ -0,0 +1,249 @@
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+using std::vector;
+
+#include "MultiSha256.h"
+
+#ifdef ECRP_MULTI_SHA256
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+		namespace multisha256 {
+
+			namespace {
+
+				struct CpuFeatures {
+					size_t maxLaneCount;
+					bool hasSha;
+				};
+
+				CpuFeatures detectFeatures() {
+					CpuFeatures features;
+					features.maxLaneCount = 1;
+					features.hasSha = false;
+#ifdef ECRP_MULTI_SHA256
+#ifdef _MSC_VER
+					int info[4];
+					__cpuid(info, 0);
+					int maxLeaf = info[0];
+					__cpuid(info, 1);
+					bool hasSse2 = (info[3] & (1 << 26)) != 0;
+					// AVX2 also needs the OS to save the YMM registers
+					bool hasAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+					bool hasAvx2 = false;
+					if (maxLeaf >= 7) {
+						__cpuidex(info, 7, 0);
+						hasAvx2 = hasAvx && (info[1] & (1 << 5)) != 0;
+						features.hasSha = (info[1] & (1 << 29)) != 0;
+					}
+#else
+					__builtin_cpu_init();
+					bool hasSse2 = __builtin_cpu_supports("sse2") != 0;
+					bool hasAvx2 = __builtin_cpu_supports("avx2") != 0;
+					if (__get_cpuid_max(0, NULL) >= 7) {
+						unsigned int a, b, c, d;
+						__cpuid_count(7, 0, a, b, c, d);
+						features.hasSha = (b & (1 << 29)) != 0;
+					}
+#endif
+					if (hasAvx2) {
+						features.maxLaneCount = 8;
+					} else if (hasSse2) {
+						features.maxLaneCount = 4;
+					}
+#endif
+					return features;
+				}
+
+				const CpuFeatures& getFeatures() {
+					static const CpuFeatures features = detectFeatures();
+					return features;
+				}
+
+				// The lanes of a single message, for the messages hashed from a midstate when there is no SIMD kernel.
+				struct Scalar {
+					typedef uint32_t Vector;
+					static const size_t LANE_COUNT = 1;
+
+					static inline Vector splat(uint32_t x) {
+						return x;
+					}
+					static inline void loadWords(const byte* const* blocks, Vector* w) {
+						for (size_t i = 0; i < 16; ++i) {
+							const byte* p = blocks[0] + 4 * i;
+							w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+						}
+					}
+					static inline void store(Vector x, uint32_t* words) {
+						words[0] = x;
+					}
+					static inline Vector add(Vector a, Vector b) {
+						return a + b;
+					}
+					static inline Vector and2(Vector a, Vector b) {
+						return a & b;
+					}
+					static inline Vector andNot(Vector a, Vector b) {
+						return ~a & b;
+					}
+					static inline Vector or2(Vector a, Vector b) {
+						return a | b;
+					}
+					static inline Vector xor2(Vector a, Vector b) {
+						return a ^ b;
+					}
+					static inline Vector xor3(Vector a, Vector b, Vector c) {
+						return a ^ b ^ c;
+					}
+					template<int n> static inline Vector shr(Vector x) {
+						return x >> n;
+					}
+					template<int n> static inline Vector rotr(Vector x) {
+						return (x >> n) | (x << (32 - n));
+					}
+				};
+
+				struct BlockCountLess {
+					const vector<Lane>* lanes;
+
+					bool operator()(size_t a, size_t b) const {
+						return (*lanes)[a].blockCount < (*lanes)[b].blockCount;
+					}
+				};
+			}
+
+			void initLane(Lane& lane, const void* pData, size_t size, uint64_t prefixSize) {
+				size_t tailSize = size % BLOCK_SIZE;
+				size_t tailBlockCount = (tailSize + 1 + sizeof(uint64_t) <= BLOCK_SIZE) ? 1 : 2;
+
+				lane.pData = (const byte*)pData;
+				lane.fullBlockCount = size / BLOCK_SIZE;
+				lane.blockCount = lane.fullBlockCount + tailBlockCount;
+
+				memset(lane.tail, 0, sizeof(lane.tail));
+				if (tailSize > 0) {
+					memcpy(lane.tail, lane.pData + lane.fullBlockCount * BLOCK_SIZE, tailSize);
+				}
+				lane.tail[tailSize] = 0x80;
+
+				uint64_t bitCount = (prefixSize + size) * 8;
+				byte* end = lane.tail + tailBlockCount * BLOCK_SIZE;
+				for (size_t k = 0; k < sizeof(bitCount); ++k) {
+					end[-1 - (ptrdiff_t)k] = (byte)(bitCount >> (8 * k));
+				}
+			}
+
+			size_t getMaxLaneCount() {
+				return getFeatures().maxLaneCount;
+			}
+
+			size_t getLaneCount() {
+				// libgcrypt hashes a message with the SHA extensions faster than the kernels do eight
+				return getFeatures().hasSha ? 1 : getFeatures().maxLaneCount;
+			}
+
+			void hashMessages(const HashInput* pInputs, b256* pOutputs, size_t count, size_t laneCount, const Sha256Midstate* pMidstate) {
+				const uint32_t* pInitialState = pMidstate ? pMidstate->state : INITIAL_STATE;
+				uint64_t prefixSize = pMidstate ? pMidstate->size : 0;
+#ifdef ECRP_MULTI_SHA256
+				if (laneCount > 1 && count > 1) {
+					vector<Lane> lanes(count);
+					vector<size_t> order(count);
+					for (size_t i = 0; i < count; ++i) {
+						initLane(lanes[i], pInputs[i].pData, pInputs[i].size, prefixSize);
+						order[i] = i;
+					}
+
+					// messages of the same length share their lanes, so that no lane waits for a longer one
+					BlockCountLess less;
+					less.lanes = &lanes;
+					std::stable_sort(order.begin(), order.end(), less);
+
+					Lane empty;
+					initLane(empty, NULL, 0);
+
+					const Lane* group[MAX_LANE_COUNT];
+					b256* outputs[MAX_LANE_COUNT];
+					for (size_t begin = 0; begin < count; begin += laneCount) {
+						// a short last group is hashed by the narrower kernel when it fits there
+						size_t groupSize = std::min(laneCount, count - begin);
+						size_t groupLaneCount = (groupSize <= 4) ? 4 : laneCount;
+						for (size_t k = 0; k < groupLaneCount; ++k) {
+							group[k] = (k < groupSize) ? &lanes[order[begin + k]] : &empty;
+							outputs[k] = (k < groupSize) ? &pOutputs[order[begin + k]] : NULL;
+						}
+
+						if (groupLaneCount == 8) {
+							hashLanesAvx2(group, outputs, pInitialState);
+						} else {
+							hashLanesSse2(group, outputs, pInitialState);
+						}
+					}
+					return;
+				}
+#endif
+				if (pMidstate == NULL) {
+					for (size_t i = 0; i < count; ++i) {
+						pOutputs[i] = sha256(pInputs[i].pData, pInputs[i].size);
+					}
+					return;
+				}
+
+				// libgcrypt cannot start from a given state
+				for (size_t i = 0; i < count; ++i) {
+					Lane lane;
+					initLane(lane, pInputs[i].pData, pInputs[i].size, prefixSize);
+					const Lane* lanes[1] = { &lane };
+					b256* outputs[1] = { &pOutputs[i] };
+					hashLanes<Scalar>(lanes, outputs, pInitialState);
+				}
+			}
+		}
+
+		void sha256_many(const HashInput* pInputs, b256* pOutputs, size_t count) {
+			multisha256::hashMessages(pInputs, pOutputs, count, multisha256::getLaneCount());
+		}
+
+		void sha256_midstate(const void* pPrefixData, size_t prefixSize, Sha256Midstate& output) {
+			using namespace multisha256;
+
+			memcpy(output.state, INITIAL_STATE, sizeof(output.state));
+			output.size = prefixSize - prefixSize % BLOCK_SIZE;
+			if (output.size == 0) {
+				return;
+			}
+
+			// a lane without a padded end stops after its last full block, and its digest is that state
+			Lane lane;
+			lane.pData = (const byte*)pPrefixData;
+			lane.fullBlockCount = prefixSize / BLOCK_SIZE;
+			lane.blockCount = lane.fullBlockCount;
+			const Lane* lanes[1] = { &lane };
+			b256 digest;
+			b256* outputs[1] = { &digest };
+			hashLanes<Scalar>(lanes, outputs, INITIAL_STATE);
+
+			for (size_t i = 0; i < 8; ++i) {
+				const byte* p = digest.b + 4 * i;
+				output.state[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+			}
+		}
+
+		void sha256_many(const Sha256Midstate& midstate, const HashInput* pInputs, b256* pOutputs, size_t count) {
+			// the SHA extensions only serve through libgcrypt, which hashes whole messages
+			multisha256::hashMessages(pInputs, pOutputs, count, multisha256::getMaxLaneCount(), &midstate);
+		}
+	}
+}
\ No newline at end of file
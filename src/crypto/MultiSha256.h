@@ -0,0 +1,170 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Crypto.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define ECRP_MULTI_SHA256
+#endif
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+		namespace multisha256 {
+
+			// Multi-buffer SHA-256: every lane of a SIMD register runs the compression of its own message, so that
+			// the many small independent messages of Merkle trees, txids and proof-of-work are hashed several at
+			// a time. The kernels live in their own translation units, each built for its instruction set, and
+			// this header must be included there after the target is set so that hashLanes is built for it too.
+
+			const size_t BLOCK_SIZE = 64;
+			const size_t MAX_LANE_COUNT = 8;
+
+			// A message cut into blocks: the full ones are read in place, the padded end is copied into the tail.
+			struct Lane {
+				const byte* pData;
+				size_t fullBlockCount;
+				size_t blockCount;
+				byte tail[2 * BLOCK_SIZE];
+			};
+
+			// The padded end of a message hashed from a midstate also counts the prefixSize bytes already compressed.
+			void initLane(Lane& lane, const void* pData, size_t size, uint64_t prefixSize = 0);
+
+			// 8 with AVX2, 4 with SSE2, 1 when there is no SIMD kernel for the CPU.
+			size_t getMaxLaneCount();
+
+			// The lane count used by sha256_many: 1 as well when the CPU has the SHA extensions.
+			size_t getLaneCount();
+
+			// Hashes the messages laneCount at a time, the CPU being expected to support that count, starting from
+			// the midstate when there is one.
+			void hashMessages(const HashInput* pInputs, b256* pOutputs, size_t count, size_t laneCount, const Sha256Midstate* pMidstate = NULL);
+
+#ifdef ECRP_MULTI_SHA256
+			// Each hashes as many messages as it has lanes from the given state, a NULL output marking a lane left unused.
+			void hashLanesSse2(const Lane* const* lanes, b256* const* outputs, const uint32_t* pInitialState);
+			void hashLanesAvx2(const Lane* const* lanes, b256* const* outputs, const uint32_t* pInitialState);
+#endif
+
+			const uint32_t ROUND_CONSTANTS[64] = {
+				0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+				0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+				0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+				0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+				0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+				0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+				0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+				0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+			};
+
+			const uint32_t INITIAL_STATE[8] = {
+				0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+			};
+
+			static inline const byte* getBlock(const Lane& lane, size_t i) {
+				return (i < lane.fullBlockCount) ? lane.pData + i * BLOCK_SIZE : lane.tail + (i - lane.fullBlockCount) * BLOCK_SIZE;
+			}
+
+			// One round over w, the 16 last words of the message schedule, extended in place from round 16 on.
+			template<class V> inline void doRound(typename V::Vector a, typename V::Vector b, typename V::Vector c, typename V::Vector& d,
+				typename V::Vector e, typename V::Vector f, typename V::Vector g, typename V::Vector& h, typename V::Vector* w, size_t t) {
+				typedef typename V::Vector T;
+
+				if (t >= 16) {
+					const T& w2 = w[(t - 2) & 15];
+					const T& w15 = w[(t - 15) & 15];
+					T s0 = V::xor3(V::template rotr<7>(w15), V::template rotr<18>(w15), V::template shr<3>(w15));
+					T s1 = V::xor3(V::template rotr<17>(w2), V::template rotr<19>(w2), V::template shr<10>(w2));
+					w[t & 15] = V::add(V::add(w[t & 15], s0), V::add(w[(t - 7) & 15], s1));
+				}
+
+				T bigSigma1 = V::xor3(V::template rotr<6>(e), V::template rotr<11>(e), V::template rotr<25>(e));
+				T choice = V::xor2(V::and2(e, f), V::andNot(e, g));
+				T t1 = V::add(V::add(V::add(h, bigSigma1), V::add(choice, V::splat(ROUND_CONSTANTS[t]))), w[t & 15]);
+
+				T bigSigma0 = V::xor3(V::template rotr<2>(a), V::template rotr<13>(a), V::template rotr<22>(a));
+				T majority = V::or2(V::and2(a, b), V::and2(c, V::or2(a, b)));
+
+				d = V::add(d, t1);
+				h = V::add(t1, V::add(bigSigma0, majority));
+			}
+
+			// V wraps a SIMD register of V::LANE_COUNT 32-bit words: splat, store, add, and, or, xor, andNot (~a & b),
+			// shr<n> and rotr<n>, plus loadWords which reads the 16 big-endian words of a block from every lane.
+			template<class V> void hashLanes(const Lane* const* lanes, b256* const* outputs, const uint32_t* pInitialState) {
+				typedef typename V::Vector T;
+				const size_t N = V::LANE_COUNT;
+
+				size_t blockCount = 0;
+				for (size_t k = 0; k < N; ++k) {
+					if (lanes[k]->blockCount > blockCount) {
+						blockCount = lanes[k]->blockCount;
+					}
+				}
+
+				T state[8];
+				for (size_t i = 0; i < 8; ++i) {
+					state[i] = V::splat(pInitialState[i]);
+				}
+
+				uint32_t words[N];
+				for (size_t j = 0; j < blockCount; ++j) {
+					// the lanes already done hash their last block again, and that result is dropped
+					const byte* blocks[N];
+					for (size_t k = 0; k < N; ++k) {
+						blocks[k] = getBlock(*lanes[k], (j < lanes[k]->blockCount) ? j : lanes[k]->blockCount - 1);
+					}
+
+					T w[16];
+					V::loadWords(blocks, w);
+
+					T a = state[0], b = state[1], c = state[2], d = state[3];
+					T e = state[4], f = state[5], g = state[6], h = state[7];
+					for (size_t t = 0; t < 64; t += 8) {
+						// the variables take turns instead of being shifted after every round
+						doRound<V>(a, b, c, d, e, f, g, h, w, t + 0);
+						doRound<V>(h, a, b, c, d, e, f, g, w, t + 1);
+						doRound<V>(g, h, a, b, c, d, e, f, w, t + 2);
+						doRound<V>(f, g, h, a, b, c, d, e, w, t + 3);
+						doRound<V>(e, f, g, h, a, b, c, d, w, t + 4);
+						doRound<V>(d, e, f, g, h, a, b, c, w, t + 5);
+						doRound<V>(c, d, e, f, g, h, a, b, w, t + 6);
+						doRound<V>(b, c, d, e, f, g, h, a, w, t + 7);
+					}
+
+					state[0] = V::add(state[0], a);
+					state[1] = V::add(state[1], b);
+					state[2] = V::add(state[2], c);
+					state[3] = V::add(state[3], d);
+					state[4] = V::add(state[4], e);
+					state[5] = V::add(state[5], f);
+					state[6] = V::add(state[6], g);
+					state[7] = V::add(state[7], h);
+
+					for (size_t i = 0; i < 8; ++i) {
+						bool isStored = false;
+						for (size_t k = 0; k < N; ++k) {
+							if (outputs[k] == NULL || lanes[k]->blockCount != j + 1) {
+								continue;
+							}
+							if (!isStored) {
+								V::store(state[i], words);
+								isStored = true;
+							}
+							byte* p = outputs[k]->b + 4 * i;
+							p[0] = (byte)(words[k] >> 24);
+							p[1] = (byte)(words[k] >> 16);
+							p[2] = (byte)(words[k] >> 8);
+							p[3] = (byte)words[k];
+						}
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
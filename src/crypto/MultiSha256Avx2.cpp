@@ -0,0 +1,114 @@
+
+#include "Crypto.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+#include <immintrin.h>
+
+// the kernel is built for AVX2 whatever the target of the rest of the build, and only run when the CPU has it
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include "MultiSha256.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+		namespace multisha256 {
+
+			namespace {
+
+				struct Avx2 {
+					typedef __m256i Vector;
+					static const size_t LANE_COUNT = 8;
+
+					static inline Vector splat(uint32_t x) {
+						return _mm256_set1_epi32((int)x);
+					}
+					static inline void loadWords(const byte* const* blocks, Vector* w) {
+						const __m256i byteOrder = _mm256_setr_epi8(
+							3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+							3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+						// eight words of every lane at a time, transposed so that each register holds one word of all lanes
+						for (size_t q = 0; q < 2; ++q) {
+							__m256i r[8];
+							for (size_t k = 0; k < 8; ++k) {
+								r[k] = _mm256_loadu_si256((const __m256i*)(blocks[k] + 32 * q));
+							}
+
+							__m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+							__m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+							__m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+							__m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+							__m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+							__m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+							__m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+							__m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+							__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+							__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+							__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+							__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+							__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+							__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+							__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+							__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+							Vector* p = w + 8 * q;
+							p[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x20), byteOrder);
+							p[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x20), byteOrder);
+							p[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x20), byteOrder);
+							p[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x20), byteOrder);
+							p[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u0, u4, 0x31), byteOrder);
+							p[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u1, u5, 0x31), byteOrder);
+							p[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u2, u6, 0x31), byteOrder);
+							p[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u3, u7, 0x31), byteOrder);
+						}
+					}
+					static inline void store(Vector x, uint32_t* words) {
+						_mm256_storeu_si256((__m256i*)words, x);
+					}
+					static inline Vector add(Vector a, Vector b) {
+						return _mm256_add_epi32(a, b);
+					}
+					static inline Vector and2(Vector a, Vector b) {
+						return _mm256_and_si256(a, b);
+					}
+					static inline Vector andNot(Vector a, Vector b) {
+						return _mm256_andnot_si256(a, b);
+					}
+					static inline Vector or2(Vector a, Vector b) {
+						return _mm256_or_si256(a, b);
+					}
+					static inline Vector xor2(Vector a, Vector b) {
+						return _mm256_xor_si256(a, b);
+					}
+					static inline Vector xor3(Vector a, Vector b, Vector c) {
+						return _mm256_xor_si256(_mm256_xor_si256(a, b), c);
+					}
+					template<int n> static inline Vector shr(Vector x) {
+						return _mm256_srli_epi32(x, n);
+					}
+					template<int n> static inline Vector rotr(Vector x) {
+						return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+					}
+				};
+			}
+
+			void hashLanesAvx2(const Lane* const* lanes, b256* const* outputs, const uint32_t* pInitialState) {
+				hashLanes<Avx2>(lanes, outputs, pInitialState);
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif
\ No newline at end of file
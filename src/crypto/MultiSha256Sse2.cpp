@@ -0,0 +1,97 @@
+
+#include "Crypto.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+
+#include <emmintrin.h>
+
+// the kernel is built for SSE2 whatever the target of the rest of the build, and only run when the CPU has it
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse2")
+#endif
+
+#include "MultiSha256.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+	namespace crypto {
+		namespace multisha256 {
+
+			namespace {
+
+				struct Sse2 {
+					typedef __m128i Vector;
+					static const size_t LANE_COUNT = 4;
+
+					static inline Vector splat(uint32_t x) {
+						return _mm_set1_epi32((int)x);
+					}
+					static inline Vector byteSwap(Vector x) {
+						// SSE2 has no byte shuffle: swap the bytes of each half, then the halves of each word
+						x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+						return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+					}
+					static inline void loadWords(const byte* const* blocks, Vector* w) {
+						// four words of every lane at a time, transposed so that each register holds one word of all lanes
+						for (size_t q = 0; q < 4; ++q) {
+							__m128i r0 = _mm_loadu_si128((const __m128i*)(blocks[0] + 16 * q));
+							__m128i r1 = _mm_loadu_si128((const __m128i*)(blocks[1] + 16 * q));
+							__m128i r2 = _mm_loadu_si128((const __m128i*)(blocks[2] + 16 * q));
+							__m128i r3 = _mm_loadu_si128((const __m128i*)(blocks[3] + 16 * q));
+
+							__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+							__m128i t1 = _mm_unpackhi_epi32(r0, r1);
+							__m128i t2 = _mm_unpacklo_epi32(r2, r3);
+							__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+							w[4 * q + 0] = byteSwap(_mm_unpacklo_epi64(t0, t2));
+							w[4 * q + 1] = byteSwap(_mm_unpackhi_epi64(t0, t2));
+							w[4 * q + 2] = byteSwap(_mm_unpacklo_epi64(t1, t3));
+							w[4 * q + 3] = byteSwap(_mm_unpackhi_epi64(t1, t3));
+						}
+					}
+					static inline void store(Vector x, uint32_t* words) {
+						_mm_storeu_si128((__m128i*)words, x);
+					}
+					static inline Vector add(Vector a, Vector b) {
+						return _mm_add_epi32(a, b);
+					}
+					static inline Vector and2(Vector a, Vector b) {
+						return _mm_and_si128(a, b);
+					}
+					static inline Vector andNot(Vector a, Vector b) {
+						return _mm_andnot_si128(a, b);
+					}
+					static inline Vector or2(Vector a, Vector b) {
+						return _mm_or_si128(a, b);
+					}
+					static inline Vector xor2(Vector a, Vector b) {
+						return _mm_xor_si128(a, b);
+					}
+					static inline Vector xor3(Vector a, Vector b, Vector c) {
+						return _mm_xor_si128(_mm_xor_si128(a, b), c);
+					}
+					template<int n> static inline Vector shr(Vector x) {
+						return _mm_srli_epi32(x, n);
+					}
+					template<int n> static inline Vector rotr(Vector x) {
+						return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+					}
+				};
+			}
+
+			void hashLanesSse2(const Lane* const* lanes, b256* const* outputs, const uint32_t* pInitialState) {
+				hashLanes<Sse2>(lanes, outputs, pInitialState);
+			}
+		}
+	}
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+#endif
\ No newline at end of file
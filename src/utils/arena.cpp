@@ -0,0 +1,62 @@
+
+#include <cstdint>
+#include <algorithm>
+
+#include "arena.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+
+	Arena::Arena(size_t chunkSize) {
+		_current = NULL;
+		_remaining = 0;
+		_chunkSize = chunkSize;
+	}
+
+	Arena::~Arena() {
+		clear();
+	}
+
+	void Arena::reserve(size_t size) {
+		if (size > _remaining) {
+			addChunk(size);
+		}
+	}
+
+	void* Arena::allocate(size_t size, size_t alignment) {
+		size_t padding = (alignment - (uintptr_t)_current % alignment) % alignment;
+
+		if (_current == NULL || padding + size > _remaining) {
+			addChunk(size + alignment);
+			padding = (alignment - (uintptr_t)_current % alignment) % alignment;
+		}
+
+		void* p = _current + padding;
+		_current += padding + size;
+		_remaining -= padding + size;
+		return p;
+	}
+
+	void Arena::clear() {
+		for (size_t i = _destructors.size(); i > 0; --i) {
+			_destructors[i - 1].destroy(_destructors[i - 1].object);
+		}
+		_destructors.clear();
+
+		for (size_t i = 0; i < _chunks.size(); ++i) {
+			delete[] _chunks[i];
+		}
+		_chunks.clear();
+
+		_current = NULL;
+		_remaining = 0;
+	}
+
+	void Arena::addChunk(size_t size) {
+		size = std::max(size, _chunkSize);
+		_current = new byte[size];
+		_remaining = size;
+		_chunks.push_back(_current);
+	}
+}
\ No newline at end of file
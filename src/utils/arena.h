@@ -0,0 +1,74 @@
+
+#pragma once
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+using std::vector;
+
+#include "byte.h"
+
+//----------------------------------------------------------------------
+
+namespace ecrp {
+
+	// Bump allocator releasing everything it handed out in one shot. Objects built with create() have their
+	// destructor run (in reverse creation order) when the arena is cleared or destroyed, they must not be deleted.
+	class Arena {
+
+	private: // CONSTANTS
+
+		static const size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+	private: // MEMBERS
+
+		struct Destructor {
+			void (*destroy)(void*);
+			void* object;
+		};
+
+		vector<byte*> _chunks;
+		vector<Destructor> _destructors;
+		byte* _current;
+		size_t _remaining;
+		size_t _chunkSize;
+
+	public: // CONSTRUCTORS
+
+		Arena(size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+		virtual ~Arena();
+
+	private:
+
+		Arena(const Arena&);
+		Arena& operator=(const Arena&);
+
+	public: // METHODS
+
+		// Makes sure the next allocations totalling up to size bytes are served from a single chunk.
+		void reserve(size_t size);
+		void* allocate(size_t size, size_t alignment);
+		void clear();
+
+		template<class T, class... Args> T* create(Args&&... args) {
+			T* t = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			if (!std::is_trivially_destructible<T>::value) {
+				Destructor d = { &destroy<T>, t };
+				_destructors.push_back(d);
+			}
+			return t;
+		}
+
+	private: // METHODS
+
+		void addChunk(size_t size);
+
+		template<class T> static void destroy(void* object) {
+			static_cast<T*>(object)->~T();
+		}
+
+	};
+}
\ No newline at end of file
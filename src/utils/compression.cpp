@@ -3,11 +3,16 @@
 #include <sstream>
 #include <stdexcept>
 #include <cstring>
+#include <unordered_map>
+#include <queue>
+#include <algorithm>
 
 #include "compression.h"
 
 using std::runtime_error;
 using std::ostringstream;
+using std::unordered_map;
+using std::priority_queue;
 
 //----------------------------------------------------------------------
 
@@ -86,4 +91,178 @@ namespace ecrp {
 
         return outstring;
     }
+
+    void compress(const byte* data, size_t length, const vector<byte>& dictionary, vector<byte>& output, int compressionlevel) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+
+        if (deflateInit(&zs, compressionlevel) != Z_OK) {
+            throw runtime_error("deflateInit failed while compressing.");
+        }
+
+        if (!dictionary.empty() && deflateSetDictionary(&zs, dictionary.data(), (uInt)dictionary.size()) != Z_OK) {
+            deflateEnd(&zs);
+            throw runtime_error("deflateSetDictionary failed while compressing.");
+        }
+
+        // deflateBound() is an upper bound of the compressed size, so a single deflate() call is enough
+        size_t position = output.size();
+        output.resize(position + deflateBound(&zs, (uLong)length));
+
+        zs.next_in = (Bytef *)data;
+        zs.avail_in = (uInt)length;
+        zs.next_out = output.data() + position;
+        zs.avail_out = (uInt)(output.size() - position);
+
+        int ret = deflate(&zs, Z_FINISH);
+        output.resize(position + zs.total_out);
+
+        deflateEnd(&zs);
+
+        if (ret != Z_STREAM_END) {
+            ostringstream oss;
+            oss << "Exception during zlib compression: (" << ret << ") " << (zs.msg ? zs.msg : "");
+            throw runtime_error(oss.str());
+        }
+    }
+
+    void decompress(const byte* data, size_t length, const vector<byte>& dictionary, byte* output, size_t outputLength) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+
+        if (inflateInit(&zs) != Z_OK) {
+            throw runtime_error("inflateInit failed while decompressing.");
+        }
+
+        zs.next_in = (Bytef *)data;
+        zs.avail_in = (uInt)length;
+        zs.next_out = output;
+        zs.avail_out = (uInt)outputLength;
+
+        int ret = inflate(&zs, Z_FINISH);
+        if (ret == Z_NEED_DICT) {
+            // zlib checks the dictionary against the Adler-32 checksum stored in the stream
+            if (dictionary.empty() || inflateSetDictionary(&zs, dictionary.data(), (uInt)dictionary.size()) != Z_OK) {
+                inflateEnd(&zs);
+                throw runtime_error("The data was compressed with another dictionary.");
+            }
+            ret = inflate(&zs, Z_FINISH);
+        }
+
+        size_t total = zs.total_out;
+        inflateEnd(&zs);
+
+        if (ret != Z_STREAM_END || total != outputLength) {
+            ostringstream oss;
+            oss << "Exception during zlib decompression: (" << ret << ") " << (zs.msg ? zs.msg : "");
+            throw runtime_error(oss.str());
+        }
+    }
+
+    vector<byte> trainDictionary(const vector<vector<byte> >& samples, size_t maxSize) {
+        const size_t WINDOW_SIZE = 8;
+        const size_t SEGMENT_SIZE = 32;
+
+        struct Frequency {
+            uint32_t count;
+            uint32_t lastSample;
+        };
+
+        struct Candidate {
+            uint64_t score;
+            uint32_t sample;
+            uint32_t offset;
+
+            bool operator<(const Candidate& other) const {
+                return score < other.score;
+            }
+        };
+
+        // the samples are cut so that the frequency table and the candidates stay bounded whatever their sizes
+        size_t sampleLimit = std::max(SEGMENT_SIZE, MAX_DICTIONARY_SAMPLE_SIZE / std::max<size_t>(1, samples.size()));
+        auto sampleSize = [&](size_t sample) {
+            return std::min(samples[sample].size(), sampleLimit);
+        };
+
+        // Every window of 8 bytes is counted once per sample containing it, so that a sequence repeated
+        // inside a single record does not outweigh one found in every record.
+        unordered_map<uint64_t, Frequency> frequencies;
+        for (size_t s = 0; s < samples.size(); ++s) {
+            for (size_t i = 0; i + WINDOW_SIZE <= sampleSize(s); ++i) {
+                uint64_t key;
+                memcpy(&key, samples[s].data() + i, sizeof(key));
+                Frequency& f = frequencies[key];
+                if (f.lastSample != s + 1) {
+                    ++f.count;
+                    f.lastSample = (uint32_t)(s + 1);
+                }
+            }
+        }
+
+        // A segment scores the number of other samples sharing each of its windows.
+        auto score = [&](uint32_t sample, uint32_t offset) {
+            uint64_t total = 0;
+            size_t end = std::min(offset + SEGMENT_SIZE, sampleSize(sample));
+            for (size_t i = offset; i + WINDOW_SIZE <= end; ++i) {
+                uint64_t key;
+                memcpy(&key, samples[sample].data() + i, sizeof(key));
+                uint32_t count = frequencies[key].count;
+                total += count > 1 ? count - 1 : 0;
+            }
+            return total;
+        };
+
+        priority_queue<Candidate> candidates;
+        for (size_t s = 0; s < samples.size(); ++s) {
+            for (size_t i = 0; i + WINDOW_SIZE <= sampleSize(s); i += SEGMENT_SIZE / 2) {
+                Candidate c;
+                c.sample = (uint32_t)s;
+                c.offset = (uint32_t)i;
+                c.score = score(c.sample, c.offset);
+                if (c.score > 0) {
+                    candidates.push(c);
+                }
+            }
+        }
+
+        // Segments are picked greedily. Once picked, their windows are no longer counted, so that the
+        // scores of the remaining segments only reflect what the dictionary does not hold yet.
+        vector<Candidate> selected;
+        size_t size = 0;
+        while (!candidates.empty() && size < maxSize) {
+            Candidate c = candidates.top();
+            candidates.pop();
+
+            c.score = score(c.sample, c.offset);
+            if (c.score == 0) {
+                continue;
+            }
+            if (!candidates.empty() && c.score < candidates.top().score) {
+                candidates.push(c);
+                continue;
+            }
+
+            size_t end = std::min(c.offset + SEGMENT_SIZE, sampleSize(c.sample));
+            for (size_t i = c.offset; i + WINDOW_SIZE <= end; ++i) {
+                uint64_t key;
+                memcpy(&key, samples[c.sample].data() + i, sizeof(key));
+                frequencies[key].count = 0;
+            }
+
+            selected.push_back(c);
+            size += end - c.offset;
+        }
+
+        vector<byte> dictionary;
+        for (size_t k = selected.size(); k > 0; --k) {
+            const Candidate& c = selected[k - 1];
+            size_t end = std::min(c.offset + SEGMENT_SIZE, sampleSize(c.sample));
+            dictionary.insert(dictionary.end(), samples[c.sample].begin() + c.offset, samples[c.sample].begin() + end);
+        }
+        if (dictionary.size() > maxSize) {
+            dictionary.erase(dictionary.begin(), dictionary.begin() + (dictionary.size() - maxSize));
+        }
+
+        return dictionary;
+    }
 }
\ No newline at end of file
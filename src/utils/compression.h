@@ -2,14 +2,36 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 using std::string;
+using std::vector;
 
 #include "zlib.h"
+#include "byte.h"
 
 //----------------------------------------------------------------------
 
 namespace ecrp {
 	string compress(const string& str, int compressionlevel = Z_BEST_COMPRESSION);
 	string decompress(char* data, size_t length);
+
+	const size_t MAX_DICTIONARY_SIZE = 32768;
+
+	// Bytes of samples a dictionary is trained from, beyond which each sample is cut to its share.
+	const size_t MAX_DICTIONARY_SAMPLE_SIZE = 100 * MAX_DICTIONARY_SIZE;
+
+	// deflate never turns a byte of compressed data into more than this many bytes.
+	const size_t MAX_COMPRESSION_RATIO = 1032;
+
+	// Deflates data (zlib format) with a preset dictionary, which may be empty, and appends the result to output.
+	void compress(const byte* data, size_t length, const vector<byte>& dictionary, vector<byte>& output, int compressionlevel = Z_BEST_COMPRESSION);
+
+	// Inflates data straight into a caller buffer, whose size must be the exact size of the decompressed data.
+	void decompress(const byte* data, size_t length, const vector<byte>& dictionary, byte* output, size_t outputLength);
+
+	// Builds a preset dictionary out of the byte sequences shared by most samples. zlib favours the end of a
+	// dictionary (shorter distances), so the most common sequences are put last. Only the first
+	// MAX_DICTIONARY_SAMPLE_SIZE / samples.size() bytes of each sample are looked at.
+	vector<byte> trainDictionary(const vector<vector<byte> >& samples, size_t maxSize = MAX_DICTIONARY_SIZE);
 }
\ No newline at end of file
@@ -128,8 +128,8 @@ namespace ecrp {
         template<typename same_endian_type>
         class _file_istream {
             public:
-                _file_istream() : input__file_ptr(nullptr), _file_size(0L), read_length(0L) {}
-                _file_istream(const char *file) : input__file_ptr(nullptr), _file_size(0L), read_length(0L) {
+                _file_istream() : input__file_ptr(nullptr), _file_size(0), read_length(0) {}
+                _file_istream(const char *file) : input__file_ptr(nullptr), _file_size(0), read_length(0) {
                     open(file);
                 }
                 ~_file_istream() {
@@ -154,7 +154,7 @@ namespace ecrp {
                 bool is_open() {
                     return (input__file_ptr != nullptr);
                 }
-                long _file_length() const {
+                int64_t _file_length() const {
                     return _file_size;
                 }
                 // http://www.cplusplus.com/reference/cstdio/feof/
@@ -164,14 +164,23 @@ namespace ecrp {
                 bool eof() const { // not using feof(), see above
                     return read_length >= _file_size;
                 }
-                long tellg() const {
-                    return std::ftell(input__file_ptr);
+                // 64-bit positions, long being 32-bit on Windows
+                int64_t tellg() const {
+#ifdef _MSC_VER
+                    return _ftelli64(input__file_ptr);
+#else
+                    return ftello(input__file_ptr);
+#endif
                 }
-                void seekg (long pos) {
-                    std::fseek(input__file_ptr, pos, SEEK_SET);
+                void seekg (int64_t pos) {
+                    seekg(pos, SEEK_SET);
                 }
-                void seekg (long offset, int way) {
-                    std::fseek(input__file_ptr, offset, way);
+                void seekg (int64_t offset, int way) {
+#ifdef _MSC_VER
+                    _fseeki64(input__file_ptr, offset, way);
+#else
+                    fseeko(input__file_ptr, (off_t)offset, way);
+#endif
                 }
 
                 template<typename T>
@@ -202,8 +211,8 @@ namespace ecrp {
                 }
 
                 std::FILE *input__file_ptr;
-                long _file_size;
-                long read_length;
+                int64_t _file_size;
+                int64_t read_length;
                 same_endian_type m_same_type;
         };
 
@@ -422,6 +431,19 @@ namespace ecrp {
 
                     return true;
                 }
+                const byte *get_current_ptr() const {
+                    return m_arr + m_index;
+                }
+                size_t get_remaining_size() const {
+                    return m_size - m_index;
+                }
+                void skip(size_t size) {
+                    if ((m_index + size) > m_size) {
+                        throw std::runtime_error("Premature end of array!");
+                    }
+
+                    m_index += size;
+                }
 
                 template<typename T>
                 void read(T &t) {
@@ -661,19 +683,19 @@ namespace ecrp {
         class _file_ostream {
             public:
                 _file_ostream() : output__file_ptr(nullptr) {}
-                _file_ostream(const char *file) : output__file_ptr(nullptr) {
-                    open(file);
+                _file_ostream(const char *file, bool append = false) : output__file_ptr(nullptr) {
+                    open(file, append);
                 }
                 ~_file_ostream() {
                     close();
                 }
-                void open(const char *file) {
+                void open(const char *file, bool append = false) {
                     close();
 #ifdef _MSC_VER
                     output__file_ptr = nullptr;
-                    fopen_s(&output__file_ptr, file, "wb");
+                    fopen_s(&output__file_ptr, file, append ? "ab" : "wb");
 #else
-                    output__file_ptr = std::fopen(file, "wb");
+                    output__file_ptr = std::fopen(file, append ? "ab" : "wb");
 #endif
                 }
                 void flush() {
@@ -808,6 +830,82 @@ namespace ecrp {
             return ostm;
         }
 
+        template<typename same_endian_type>
+        class _ptr_ostream {
+            public:
+                _ptr_ostream() : m_arr(nullptr), m_size(0), m_index(0) {}
+                _ptr_ostream(byte *mem, size_t size) : m_arr(nullptr), m_size(0), m_index(0) {
+                    open(mem, size);
+                }
+                _ptr_ostream(std::vector<byte> &vec) {
+                    m_index = 0;
+                    m_arr = vec.data();
+                    m_size = vec.size();
+                }
+                void open(byte *mem, size_t size) {
+                    m_index = 0;
+                    m_arr = mem;
+                    m_size = size;
+                }
+                void close() {
+                    m_arr = nullptr; m_size = 0; m_index = 0;
+                }
+                size_t tellp() const {
+                    return m_index;
+                }
+                template<typename T>
+                void write(const T &t) {
+                    if ((m_index + sizeof(T)) > m_size) {
+                        throw std::runtime_error("Premature end of array!");
+                    }
+
+                    T t2 = t;
+					ecrp::io::swap(t2, m_same_type);
+                    std::memcpy(reinterpret_cast<void *>(&m_arr[m_index]), reinterpret_cast<const void *>(&t2), sizeof(T));
+
+                    m_index += sizeof(T);
+                }
+                void write(const std::vector<byte> &vec) {
+                    write(vec.data(), vec.size());
+                }
+                void write(const byte *p, size_t size) {
+                    if ((m_index + size) > m_size) {
+                        throw std::runtime_error("Premature end of array!");
+                    }
+
+                    std::memcpy(reinterpret_cast<void *>(&m_arr[m_index]), reinterpret_cast<const void *>(p), size);
+
+                    m_index += size;
+                }
+
+            private:
+                byte *m_arr;
+                size_t m_size;
+                size_t m_index;
+                same_endian_type m_same_type;
+        };
+
+        template<typename same_endian_type, typename T>
+        _ptr_ostream<same_endian_type> &operator << (_ptr_ostream<same_endian_type> &ostm, const T &val) {
+            ostm.write(val);
+
+            return ostm;
+        }
+
+        template<typename same_endian_type>
+        _ptr_ostream<same_endian_type> &operator << (_ptr_ostream<same_endian_type> &ostm, const std::string &val) {
+            int size = val.size();
+            ostm.write(size);
+
+            if (val.size() <= 0) {
+                return ostm;
+            }
+
+            ostm.write((const byte *)val.c_str(), val.size());
+
+            return ostm;
+        }
+
         template<typename same_endian_type>
         class _memfile_ostream {
             public:
@@ -914,6 +1012,10 @@ namespace ecrp {
 		typedef _mem_ostream<NativeEndian> mem_ostream;
 		typedef _mem_ostream<LittleEndian> le_mem_ostream;
 		typedef _mem_ostream<BigEndian> be_mem_ostream;
+
+		typedef _ptr_ostream<NativeEndian> ptr_ostream;
+		typedef _ptr_ostream<LittleEndian> le_ptr_ostream;
+		typedef _ptr_ostream<BigEndian> be_ptr_ostream;
 	}
 }
 
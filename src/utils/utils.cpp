@@ -2,6 +2,17 @@
 #include <string>
 #include <ctime>
 #include <chrono>
+#include <algorithm>
+#include <exception>
+#include <deque>
+
+#include <boost/thread.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "byte.h"
 #include "utils.h"
@@ -92,4 +103,197 @@ namespace ecrp {
 		milliseconds t = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
 		return (uint64_t)t.count();
 	}
+
+	bool syncFile(std::FILE* file) {
+		if (std::fflush(file) != 0) {
+			return false;
+		}
+#ifdef _WIN32
+		return _commit(_fileno(file)) == 0;
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+
+	uint32_t getProcessorCount() {
+		static const uint32_t processorCount = std::max<uint32_t>(1, boost::thread::hardware_concurrency());
+		return processorCount;
+	}
+
+	// Threads started once and fed tasks from a single queue. Every task belongs to the group of a parallelRun
+	// call, which lives on the stack of its caller until all of its tasks are done.
+	class ThreadPool {
+
+	private: // TYPES
+
+		struct Group {
+			const std::function<void(size_t)>* f;
+			size_t remainingCount;
+			std::exception_ptr error;
+		};
+
+		struct Task {
+			Group* group;
+			size_t index;
+		};
+
+	private: // MEMBERS
+
+		boost::mutex _mutex;
+		boost::condition_variable _taskAdded;
+		boost::condition_variable _taskDone;
+		std::deque<Task> _tasks;
+		boost::thread_group _threads;
+		bool _isStopping;
+
+	public: // CONSTRUCTORS
+
+		ThreadPool(uint32_t threadCount) {
+			_isStopping = false;
+
+			// a pool which cannot start all of its threads runs with the ones it has, the callers doing the rest
+			try {
+				for (uint32_t k = 0; k < threadCount; ++k) {
+					_threads.create_thread([this]() { runThread(); });
+				}
+			} catch (...) {
+			}
+		}
+
+		~ThreadPool() {
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				_isStopping = true;
+			}
+			_taskAdded.notify_all();
+			_threads.join_all();
+		}
+
+	public: // METHODS
+
+		void run(size_t taskCount, const std::function<void(size_t)>& f) {
+			if (taskCount == 0) {
+				return;
+			}
+
+			Group group;
+			group.f = &f;
+			group.remainingCount = taskCount;
+
+			Task task;
+			{
+				boost::lock_guard<boost::mutex> lock(_mutex);
+				try {
+					for (size_t i = 1; i < taskCount; ++i) {
+						task.group = &group;
+						task.index = i;
+						_tasks.push_back(task);
+					}
+				} catch (...) {
+					// no thread took any of them yet, since the lock is held
+					while (takeTask(group, task)) {
+					}
+					throw;
+				}
+			}
+			_taskAdded.notify_all();
+
+			task.group = &group;
+			task.index = 0;
+			execute(task);
+
+			for (;;) {
+				{
+					boost::lock_guard<boost::mutex> lock(_mutex);
+					if (!takeTask(group, task)) {
+						break;
+					}
+				}
+				execute(task);
+			}
+
+			boost::unique_lock<boost::mutex> lock(_mutex);
+			while (group.remainingCount > 0) {
+				_taskDone.wait(lock);
+			}
+			if (group.error) {
+				std::rethrow_exception(group.error);
+			}
+		}
+
+	private: // METHODS
+
+		void runThread() {
+			boost::unique_lock<boost::mutex> lock(_mutex);
+			for (;;) {
+				while (!_isStopping && _tasks.empty()) {
+					_taskAdded.wait(lock);
+				}
+				if (_isStopping) {
+					return;
+				}
+
+				Task task = _tasks.front();
+				_tasks.pop_front();
+				lock.unlock();
+				execute(task);
+				lock.lock();
+			}
+		}
+
+		void execute(const Task& task) {
+			std::exception_ptr error;
+			try {
+				(*task.group->f)(task.index);
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			boost::lock_guard<boost::mutex> lock(_mutex);
+			if (error && !task.group->error) {
+				task.group->error = error;
+			}
+			if (--task.group->remainingCount == 0) {
+				_taskDone.notify_all();
+			}
+		}
+
+		// Takes a task of the group out of the queue, the lock being held.
+		bool takeTask(const Group& group, Task& task) {
+			for (auto i = _tasks.begin(); i != _tasks.end(); ++i) {
+				if (i->group == &group) {
+					task = *i;
+					_tasks.erase(i);
+					return true;
+				}
+			}
+			return false;
+		}
+
+	};
+
+	void parallelRun(size_t taskCount, const std::function<void(size_t)>& f) {
+		if (taskCount <= 1) {
+			if (taskCount == 1) {
+				f(0);
+			}
+			return;
+		}
+
+		static ThreadPool pool(getProcessorCount() - 1);
+		pool.run(taskCount, f);
+	}
+
+	void parallelFor(size_t count, uint32_t threadCount, const std::function<void(size_t, size_t)>& f) {
+		if (threadCount <= 1 || count <= 1) {
+			f(0, count);
+			return;
+		}
+
+		size_t sliceSize = (count + threadCount - 1) / threadCount;
+		size_t sliceCount = (count + sliceSize - 1) / sliceSize;
+		parallelRun(sliceCount, [&](size_t i) {
+			f(i * sliceSize, std::min(count, (i + 1) * sliceSize));
+		});
+	}
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <stdexcept>
+#include <cstdio>
+#include <functional>
 
 using std::string;
 using std::runtime_error;
@@ -21,4 +23,19 @@ namespace ecrp {
     string formatKey(uint64_t key);
 	uint32_t getUnixTimestampUTC();
 	uint64_t getTimestampUTC();
+
+	// Flushes the stdio buffers of the file and waits for the data to reach the disk.
+	bool syncFile(std::FILE* file);
+
+	// The number of hardware threads, queried once and at least 1.
+	uint32_t getProcessorCount();
+
+	// Calls f(k) for every k in [0, taskCount) on the threads of a process-wide pool, started on first use with
+	// getProcessorCount() - 1 threads, and returns once every call is done, rethrowing the first exception thrown.
+	// The calling thread runs the first task, then the ones of this call no pool thread took yet, so that a
+	// nested call or a busy pool never leaves it waiting on tasks nobody runs.
+	void parallelRun(size_t taskCount, const std::function<void(size_t)>& f);
+
+	// Calls f on contiguous slices of [0, count), one per thread, through parallelRun.
+	void parallelFor(size_t count, uint32_t threadCount, const std::function<void(size_t, size_t)>& f);
 }
\ No newline at end of file